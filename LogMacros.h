@@ -4,33 +4,36 @@
 
 #pragma once
 
-#include <iostream>
-#include <sstream>
+#include "TCPLog.h"
 #include <format>
-#include <iomanip>
-#include <chrono>
-#include <ctime>
-
-inline std::string CurrentTime() {
-    auto now = std::chrono::system_clock::now();
-    auto in_time_t = std::chrono::system_clock::to_time_t(now);
-    std::tm buf{};
-#ifdef _WIN32
-    localtime_s(&buf, &in_time_t);
-#else
-    localtime_r(&in_time_t, &buf);
-#endif
-    std::stringstream ss;
-    ss << std::put_time(&buf, "%Y-%m-%d %X");
-    return ss.str();
-}
+#include <string>
 
-#ifdef _DEBUG
-#define DEBUG_MSG(fmt, ...)			std::cout << std::format("[{}] [DEBUG] [{}:{}] ", CurrentTime(), __FUNCTION__, __LINE__) << std::format(fmt, ##__VA_ARGS__) << std::endl
-#else
-#define DEBUG_MSG(fmt, ...)
+// Lowest level compiled into the library: 0 debug, 1 info, 2 error, 3 off
+#ifndef TCPCONN_MIN_LOG_LEVEL
+#   ifdef _DEBUG
+#       define TCPCONN_MIN_LOG_LEVEL 0
+#   else
+#       define TCPCONN_MIN_LOG_LEVEL 1
+#   endif
 #endif
 
-#define INFO_MSG(fmt, ...)			std::cout << std::format("[{}] [INFO] ", CurrentTime()) << std::format(fmt, ##__VA_ARGS__) << std::endl
-#define ERROR_MSG(fmt, ...)			std::cerr << std::format("[{}] [ERROR] ", CurrentTime()) << std::format(fmt, ##__VA_ARGS__) << std::endl
+namespace TCPConn {
+
+    /// \brief Whether records of this level pass the runtime filter.
+    bool LogEnabled(ELogLevel level);
+
+    /// \brief Enqueue a formatted record for the background logging thread, never blocks.
+    void LogRecord(ELogLevel level, std::string&& text);
+
+}
+
+// Only the message is formatted on the calling thread, timestamp and output are left to the logging thread
+#define TCPCONN_LOG(level, fmt, ...) \
+    do { \
+        if (int(level) >= TCPCONN_MIN_LOG_LEVEL && TCPConn::LogEnabled(level)) \
+            TCPConn::LogRecord(level, std::format(fmt, ##__VA_ARGS__)); \
+    } while (0)
 
+#define DEBUG_MSG(fmt, ...)			TCPCONN_LOG(TCPConn::ELogLevel::debug, "[{}:{}] " fmt, __FUNCTION__, __LINE__, ##__VA_ARGS__)
+#define INFO_MSG(fmt, ...)			TCPCONN_LOG(TCPConn::ELogLevel::info, fmt, ##__VA_ARGS__)
+#define ERROR_MSG(fmt, ...)			TCPCONN_LOG(TCPConn::ELogLevel::error, fmt, ##__VA_ARGS__)
@@ -0,0 +1,103 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPBUFFERPOOL_H
+#define TCPCONN_TCPBUFFERPOOL_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace TCPConn {
+
+    /// \brief Recycles message bodies, bucketed by power-of-two size classes from 64 B to 16 MB.
+    /// Buffers are taken on the io threads and given back by the consumer once a message
+    /// has been handled, so a steady stream of messages runs without heap allocations.
+    class TCPBufferPool {
+    public:
+        /// \brief Construct a pool.
+        /// \param nMaxBuffersPerClass buffers kept per size class, 0 disables pooling
+        explicit TCPBufferPool(size_t nMaxBuffersPerClass = 64) : m_nMaxBuffersPerClass(nMaxBuffersPerClass) {}
+        TCPBufferPool(const TCPBufferPool&) = delete;
+
+        /// \brief Get a buffer resized to the requested size.
+        /// \param nSize requested size in bytes
+        std::vector<uint8_t> Acquire(size_t nSize) {
+            std::vector<uint8_t> buf;
+            if (nSize == 0) return buf;
+            size_t nClass = ClassOfSize(nSize);
+            if (nClass >= NUM_CLASSES || m_nMaxBuffersPerClass == 0) {
+                buf.resize(nSize);
+                return buf;
+            }
+            {
+                auto& sizeClass = m_classes[nClass];
+                std::scoped_lock lock(sizeClass.mutex);
+                if (!sizeClass.free.empty()) {
+                    buf = std::move(sizeClass.free.back());
+                    sizeClass.free.pop_back();
+                }
+            }
+            if (buf.capacity() < nSize) buf.reserve(size_t(1) << (nClass + MIN_CLASS_SHIFT));
+            buf.resize(nSize);
+            return buf;
+        }
+
+        /// \brief Give a buffer back, dropped if its class is full or out of range.
+        /// \param buf buffer to recycle, left empty
+        void Release(std::vector<uint8_t>&& buf) {
+            size_t nCapacity = buf.capacity();
+            if (nCapacity < (size_t(1) << MIN_CLASS_SHIFT)) return;
+            // A buffer serves the largest class that fits into its capacity
+            size_t nClass = std::bit_width(nCapacity) - 1 - MIN_CLASS_SHIFT;
+            if (nClass >= NUM_CLASSES) return;
+            auto& sizeClass = m_classes[nClass];
+            std::scoped_lock lock(sizeClass.mutex);
+            if (sizeClass.free.size() < m_nMaxBuffersPerClass) {
+                buf.clear();
+                sizeClass.free.push_back(std::move(buf));
+            }
+        }
+
+    protected:
+        static constexpr size_t MIN_CLASS_SHIFT = 6;    // 64 B
+        static constexpr size_t NUM_CLASSES = 19;       // up to 16 MB
+
+        static size_t ClassOfSize(size_t nSize) {
+            size_t nShift = std::bit_width(nSize - 1);
+            return nShift <= MIN_CLASS_SHIFT ? 0 : nShift - MIN_CLASS_SHIFT;
+        }
+
+        struct SizeClass {
+            std::mutex mutex;
+            std::vector<std::vector<uint8_t>> free;
+        };
+
+        std::array<SizeClass, NUM_CLASSES> m_classes;
+        size_t m_nMaxBuffersPerClass;
+    };
+
+    /// \brief Gives the bodies of a drained batch back to the pool and clears it when leaving scope,
+    /// also when the batch callback throws, so a reused batch never delivers the same messages twice.
+    template <typename TBatch>
+    class TCPBatchRelease {
+    public:
+        TCPBatchRelease(TBatch& vecBatch, TCPBufferPool& pool) : m_vecBatch(vecBatch), m_pool(pool) {}
+        TCPBatchRelease(const TCPBatchRelease&) = delete;
+
+        ~TCPBatchRelease() {
+            for (auto& msg : m_vecBatch) m_pool.Release(std::move(msg.msg.body));
+            m_vecBatch.clear();
+        }
+
+    private:
+        TBatch& m_vecBatch;
+        TCPBufferPool& m_pool;
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPBUFFERPOOL_H
@@ -0,0 +1,285 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPCAPTURE_H
+#define TCPCONN_TCPCAPTURE_H
+
+#include "TCPMsg.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <system_error>
+
+#if defined __unix__ || defined __APPLE__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TCPCONN_HAS_CAPTURE
+#endif
+
+namespace TCPConn {
+
+    /// \brief Whether a captured message was received or sent by the recording side.
+    enum class ECaptureDirection : uint8_t {
+        inbound,    ///< delivered to `OnMessage`, `Receive()` or the interceptor
+        outbound    ///< handed to `Send`, `MessageClient` or `MessageAllClients`
+    };
+
+    /// \brief A captured message, valid as long as the `TCPCaptureReader` it came from.
+    struct TCPCaptureRecord {
+        uint64_t timestamp_ns = 0;      ///< monotonic nanoseconds since the recorder was opened
+        uint64_t connection_id = 0;     ///< `ITCPConn::GetID()` on servers, 0 on clients and raw senders
+        ECaptureDirection direction = ECaptureDirection::inbound;
+        bool framed = false;            ///< a `TCPMsg` with its header, otherwise a `TCPRawMsg`
+        const uint8_t* data = nullptr;  ///< the header and body of a `TCPMsg`, or the bytes of a `TCPRawMsg`
+        size_t size = 0;
+
+        [[nodiscard]] TCPMsg ToMsg() const {
+            TCPMsg msg;
+            if (!framed || size < sizeof(TCPMsgHeader)) return msg;
+            std::memcpy(&msg.header, data, sizeof(TCPMsgHeader));
+            msg.body.assign(data + sizeof(TCPMsgHeader), data + size);
+            return msg;
+        }
+
+        [[nodiscard]] TCPRawMsg ToRawMsg() const {
+            TCPRawMsg msg;
+            msg.body.assign(data, data + size);
+            return msg;
+        }
+    };
+
+    namespace detail {
+
+        // File layout: the header, then records of TCPCaptureRecordHeader and payload padded to 8 bytes
+        struct TCPCaptureFileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t header_size;
+            uint64_t start_unix_ns;     // wall clock when recording started, to place timestamps in time
+            uint64_t data_end;          // offset past the last complete record, updated after every append
+            uint64_t records;
+            uint8_t reserved[24];
+        };
+        static_assert(sizeof(TCPCaptureFileHeader) == 64);
+
+        struct TCPCaptureRecordHeader {
+            uint64_t timestamp_ns;
+            uint64_t connection_id;
+            uint32_t size;
+            uint8_t direction;
+            uint8_t framed;
+            uint16_t reserved;
+        };
+        static_assert(sizeof(TCPCaptureRecordHeader) == 24);
+
+        inline constexpr char TCPCAPTURE_MAGIC[8] = {'T', 'C', 'P', 'C', 'A', 'P', '\0', '\0'};
+        inline constexpr uint32_t TCPCAPTURE_VERSION = 1;
+
+        inline size_t CapturePadded(size_t nSize) { return (nSize + 7) & ~size_t(7); }
+
+    } // detail
+
+    /// \brief Appends every message it is handed to a memory-mapped capture file.
+    /// Set as `TCPConnConfig::capture` to record all connections of a server, client or raw sender;
+    /// any number of io and sending threads may record into one file. The file grows in chunks and
+    /// is trimmed to its records when the recorder is destroyed, a capture cut short by a crash
+    /// stays readable up to the last complete record.
+    class TCPCaptureRecorder {
+    public:
+        /// \brief Create a capture file, replacing an existing one.
+        /// \param path file to write
+        /// \param nChunkBytes bytes the file grows by whenever it is full
+        /// \throw std::system_error if the file cannot be created or mapped
+        explicit TCPCaptureRecorder(const std::string& path, size_t nChunkBytes = 64 << 20)
+                : m_nChunk(detail::CapturePadded(std::max<size_t>(nChunkBytes, 4096))),
+                  m_tStart(std::chrono::steady_clock::now()) {
+#ifdef TCPCONN_HAS_CAPTURE
+            m_nFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (m_nFd < 0) throw std::system_error(errno, std::system_category(), "Cannot create capture " + path);
+            Grow(m_nChunk);
+            detail::TCPCaptureFileHeader header{};
+            std::memcpy(header.magic, detail::TCPCAPTURE_MAGIC, sizeof(header.magic));
+            header.version = detail::TCPCAPTURE_VERSION;
+            header.header_size = sizeof(header);
+            header.start_unix_ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count());
+            header.data_end = m_nEnd = sizeof(header);
+            std::memcpy(m_pMap, &header, sizeof(header));
+#else
+            throw std::system_error(std::make_error_code(std::errc::not_supported), "Capture files need mmap");
+#endif
+        }
+        TCPCaptureRecorder(const TCPCaptureRecorder&) = delete;
+
+        ~TCPCaptureRecorder() {
+#ifdef TCPCONN_HAS_CAPTURE
+            munmap(m_pMap, m_nMapped);
+            if (ftruncate(m_nFd, off_t(m_nEnd)) != 0) {}
+            ::close(m_nFd);
+#endif
+        }
+
+        void Record(ECaptureDirection direction, uint64_t nConnectionID, const TCPMsg& msg) {
+            Append(direction, nConnectionID, true, &msg.header, sizeof(TCPMsgHeader), msg.body.data(), msg.body.size());
+        }
+
+        void Record(ECaptureDirection direction, uint64_t nConnectionID, const TCPRawMsg& msg) {
+            Append(direction, nConnectionID, false, msg.body.data(), msg.body.size(), nullptr, 0);
+        }
+
+        /// \brief Number of messages recorded so far.
+        [[nodiscard]] uint64_t Records() const {
+            std::scoped_lock lock(m_mtx);
+            return m_nRecords;
+        }
+
+        /// \brief Size of the capture so far in bytes.
+        [[nodiscard]] uint64_t Bytes() const {
+            std::scoped_lock lock(m_mtx);
+            return m_nEnd;
+        }
+
+    private:
+        void Append(ECaptureDirection direction, uint64_t nConnectionID, bool bFramed,
+                    const void* pFirst, size_t nFirst, const void* pSecond, size_t nSecond) {
+#ifdef TCPCONN_HAS_CAPTURE
+            // Taken before the lock, so timestamps follow the order messages were handed over
+            auto nNow = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - m_tStart).count());
+            detail::TCPCaptureRecordHeader record{nNow, nConnectionID, uint32_t(nFirst + nSecond),
+                                                  uint8_t(direction), uint8_t(bFramed), 0};
+            size_t nRecord = sizeof(record) + detail::CapturePadded(nFirst + nSecond);
+            std::scoped_lock lock(m_mtx);
+            if (!m_pMap) return;
+            if (m_nEnd + nRecord > m_nMapped) Grow(m_nEnd + nRecord + m_nChunk);
+            if (!m_pMap) return;
+            uint8_t* pDst = m_pMap + m_nEnd;
+            record.timestamp_ns = std::max(record.timestamp_ns, m_nLastTimestamp);
+            m_nLastTimestamp = record.timestamp_ns;
+            std::memcpy(pDst, &record, sizeof(record));
+            if (nFirst > 0) std::memcpy(pDst + sizeof(record), pFirst, nFirst);
+            if (nSecond > 0) std::memcpy(pDst + sizeof(record) + nFirst, pSecond, nSecond);
+            m_nEnd += nRecord;
+            m_nRecords++;
+            auto* pHeader = reinterpret_cast<detail::TCPCaptureFileHeader*>(m_pMap);
+            pHeader->records = m_nRecords;
+            pHeader->data_end = m_nEnd;
+#endif
+        }
+
+#ifdef TCPCONN_HAS_CAPTURE
+        // Extend the file and map it again, recording stops if the disk or address space is exhausted
+        void Grow(size_t nSize) {
+            if (m_pMap) munmap(m_pMap, m_nMapped);
+            m_pMap = nullptr;
+            nSize = (nSize + m_nChunk - 1) / m_nChunk * m_nChunk;
+            if (ftruncate(m_nFd, off_t(nSize)) != 0) {
+                if (m_nMapped == 0) throw std::system_error(errno, std::system_category(), "Cannot size capture");
+                return;
+            }
+            void* pMap = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_nFd, 0);
+            if (pMap == MAP_FAILED) {
+                if (m_nMapped == 0) throw std::system_error(errno, std::system_category(), "Cannot map capture");
+                return;
+            }
+            m_pMap = static_cast<uint8_t*>(pMap);
+            m_nMapped = nSize;
+        }
+#endif
+
+        mutable std::mutex m_mtx;
+        int m_nFd = -1;
+        uint8_t* m_pMap = nullptr;
+        size_t m_nMapped = 0;
+        size_t m_nChunk;
+        size_t m_nEnd = 0;
+        uint64_t m_nRecords = 0;
+        uint64_t m_nLastTimestamp = 0;
+        std::chrono::steady_clock::time_point m_tStart;
+    };
+
+    /// \brief Reads the records of a capture file in the order they were recorded.
+    class TCPCaptureReader {
+    public:
+        /// \brief Map a capture file, which may still be written by a recorder.
+        /// \throw std::system_error if the file cannot be opened or is no capture
+        explicit TCPCaptureReader(const std::string& path) {
+#ifdef TCPCONN_HAS_CAPTURE
+            int nFd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (nFd < 0) throw std::system_error(errno, std::system_category(), "Cannot open capture " + path);
+            struct stat st{};
+            if (fstat(nFd, &st) == 0 && size_t(st.st_size) >= sizeof(detail::TCPCaptureFileHeader)) {
+                void* pMap = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, nFd, 0);
+                if (pMap != MAP_FAILED) {
+                    m_pMap = static_cast<const uint8_t*>(pMap);
+                    m_nMapped = size_t(st.st_size);
+                }
+            }
+            ::close(nFd);
+            detail::TCPCaptureFileHeader header{};
+            if (m_pMap) std::memcpy(&header, m_pMap, sizeof(header));
+            if (!m_pMap || std::memcmp(header.magic, detail::TCPCAPTURE_MAGIC, sizeof(header.magic)) != 0 ||
+                header.version != detail::TCPCAPTURE_VERSION) {
+                if (m_pMap) munmap(const_cast<uint8_t*>(m_pMap), m_nMapped);
+                throw std::system_error(std::make_error_code(std::errc::invalid_argument), "Not a capture file " + path);
+            }
+            m_nStartUnixNs = header.start_unix_ns;
+            m_nBegin = m_nPos = header.header_size;
+            m_nEnd = std::min<size_t>(header.data_end, m_nMapped);
+            m_nRecords = header.records;
+#else
+            throw std::system_error(std::make_error_code(std::errc::not_supported), "Capture files need mmap");
+#endif
+        }
+        TCPCaptureReader(const TCPCaptureReader&) = delete;
+
+        ~TCPCaptureReader() {
+#ifdef TCPCONN_HAS_CAPTURE
+            munmap(const_cast<uint8_t*>(m_pMap), m_nMapped);
+#endif
+        }
+
+        /// \brief Read the next record.
+        /// \return false at the end of the capture
+        bool Next(TCPCaptureRecord& record) {
+            detail::TCPCaptureRecordHeader header{};
+            if (m_nPos + sizeof(header) > m_nEnd) return false;
+            std::memcpy(&header, m_pMap + m_nPos, sizeof(header));
+            size_t nRecord = sizeof(header) + detail::CapturePadded(header.size);
+            if (m_nPos + nRecord > m_nEnd) return false;
+            record.timestamp_ns = header.timestamp_ns;
+            record.connection_id = header.connection_id;
+            record.direction = ECaptureDirection(header.direction);
+            record.framed = header.framed != 0;
+            record.data = m_pMap + m_nPos + sizeof(header);
+            record.size = header.size;
+            m_nPos += nRecord;
+            return true;
+        }
+
+        /// \brief Start over at the first record.
+        void Rewind() { m_nPos = m_nBegin; }
+
+        /// \brief Number of records in the capture when it was opened.
+        [[nodiscard]] uint64_t Records() const { return m_nRecords; }
+
+        /// \brief Wall clock in nanoseconds since the Unix epoch when recording started.
+        [[nodiscard]] uint64_t StartUnixNs() const { return m_nStartUnixNs; }
+
+    private:
+        const uint8_t* m_pMap = nullptr;
+        size_t m_nMapped = 0;
+        size_t m_nBegin = 0;
+        size_t m_nPos = 0;
+        size_t m_nEnd = 0;
+        uint64_t m_nRecords = 0;
+        uint64_t m_nStartUnixNs = 0;
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPCAPTURE_H
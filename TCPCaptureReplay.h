@@ -0,0 +1,123 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPCAPTUREREPLAY_H
+#define TCPCONN_TCPCAPTUREREPLAY_H
+
+#include "TCPCapture.h"
+#include "TCPClient.h"
+#include "TCPServer.h"
+#include "TCPRawMsgSender.h"
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <thread>
+
+namespace TCPConn {
+
+    /// \brief Plays the records of a capture file back in their original order and pacing.
+    /// Records are filtered by direction (outbound by default, i.e. what the recording side sent)
+    /// and optionally by connection, then handed to a sink or sent through a client, server or raw sender.
+    class TCPCaptureReplay {
+    public:
+        /// \brief `SetSpeed` value that sends records back to back, ignoring their timestamps.
+        static constexpr double AS_FAST_AS_POSSIBLE = 0;
+
+        /// \throw std::system_error if the file cannot be opened or is no capture
+        explicit TCPCaptureReplay(const std::string& path) : m_reader(path) {}
+
+        /// \brief Pace of the replay, 1 keeps the original timing, 10 plays ten times faster and
+        /// `AS_FAST_AS_POSSIBLE` does not wait at all.
+        void SetSpeed(double dSpeed) { m_dSpeed = dSpeed > 0 ? dSpeed : AS_FAST_AS_POSSIBLE; }
+
+        /// \brief Replay only records of this direction.
+        void SetDirection(ECaptureDirection direction) { m_direction = direction; }
+
+        /// \brief Replay only records of this connection ID, `std::nullopt` for all of them.
+        void SetConnection(std::optional<uint64_t> nConnectionID) { m_nConnectionID = nConnectionID; }
+
+        /// \brief Make a running `Run` return after the record it is handling, callable from any thread.
+        void Stop() { m_bStop.store(true, std::memory_order_relaxed); }
+
+        /// \brief Hand every selected record to `fnSink` at its due time, on the calling thread.
+        /// The replay starts with the first selected record, gaps before it are skipped.
+        /// \return number of records handed over
+        size_t Run(const std::function<void(const TCPCaptureRecord&)>& fnSink) {
+            using namespace std::chrono;
+            m_bStop.store(false, std::memory_order_relaxed);
+            m_reader.Rewind();
+            TCPCaptureRecord record;
+            steady_clock::time_point tStart;
+            uint64_t nFirst = 0;
+            size_t nCount = 0;
+            while (!m_bStop.load(std::memory_order_relaxed) && m_reader.Next(record)) {
+                if (record.direction != m_direction) continue;
+                if (m_nConnectionID && record.connection_id != *m_nConnectionID) continue;
+                if (m_dSpeed != AS_FAST_AS_POSSIBLE) {
+                    if (nCount == 0) {
+                        tStart = steady_clock::now();
+                        nFirst = record.timestamp_ns;
+                    }
+                    auto tDue = tStart + nanoseconds(int64_t(double(record.timestamp_ns - nFirst) / m_dSpeed));
+                    // Sleep through most of the gap, then yield up to the deadline to keep close spacing
+                    if (tDue - steady_clock::now() > microseconds(200)) std::this_thread::sleep_until(tDue - microseconds(100));
+                    while (steady_clock::now() < tDue) std::this_thread::yield();
+                }
+                fnSink(record);
+                nCount++;
+            }
+            return nCount;
+        }
+
+        /// \brief Send every selected `TCPMsg` or `TCPRawMsg` record through a connected client.
+        template <typename T>
+        size_t Run(ITCPClient<T>& client) {
+            return Run([&client](const TCPCaptureRecord& record) {
+                if constexpr (std::is_same<T, TCPMsg>::value) {
+                    if (record.framed) client.Send(record.ToMsg());
+                } else if constexpr (std::is_same<T, TCPRawMsg>::value) {
+                    if (!record.framed) client.Send(record.ToRawMsg());
+                }
+            });
+        }
+
+        /// \brief Send every selected record through a server.
+        /// \param bByConnection send each record to the client with its recorded connection ID
+        /// instead of to all clients, for replays against clients connecting in the original order
+        template <typename T>
+        size_t Run(ITCPServer<T>& server, bool bByConnection = false) {
+            return Run([&server, bByConnection](const TCPCaptureRecord& record) {
+                T msg;
+                if constexpr (std::is_same<T, TCPMsg>::value) {
+                    if (!record.framed) return;
+                    msg = record.ToMsg();
+                } else if constexpr (std::is_same<T, TCPRawMsg>::value) {
+                    if (record.framed) return;
+                    msg = record.ToRawMsg();
+                }
+                if (bByConnection) server.MessageClient(record.connection_id, std::move(msg));
+                else server.MessageAllClients(msg);
+            });
+        }
+
+        /// \brief Send every selected `TCPRawMsg` record through a connected raw sender.
+        size_t Run(ITCPRawMsgSender& sender) {
+            return Run([&sender](const TCPCaptureRecord& record) {
+                if (!record.framed) sender.Send(record.ToRawMsg());
+            });
+        }
+
+        [[nodiscard]] const TCPCaptureReader& Reader() const { return m_reader; }
+
+    private:
+        TCPCaptureReader m_reader;
+        double m_dSpeed = 1;
+        ECaptureDirection m_direction = ECaptureDirection::outbound;
+        std::optional<uint64_t> m_nConnectionID;
+        std::atomic<bool> m_bStop = false;
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPCAPTUREREPLAY_H
@@ -6,6 +6,7 @@
 #define TCPCONN_TCPCLIENT_H
 
 #include "TCPConn.h"
+#include <span>
 
 namespace TCPConn {
 
@@ -16,12 +17,24 @@ namespace TCPConn {
     class TCPCONN_API ITCPClient {
     public:
         ITCPClient();
+        
+        /// \brief Construct a client with custom connection tunables.
+        /// \param config tunables applied to the server connection
+        explicit ITCPClient(const TCPConnConfig& config);
         virtual ~ITCPClient();
         
         /// \brief Connect to a server.
+        /// \param host server address or domain name, or `unix:/path/to.sock` / `unix:@name` for a Unix domain socket,
+        /// or `shm:/path/to.sock` / `shm:@name` for shared memory set up over that socket
+        /// \param port server port, ignored for Unix domain sockets
+        bool Connect(const std::string& host, uint16_t port);
+
+        /// \brief Connect to a server and complete once the connection is validated.
+        /// Messages of this connection are then delivered to `Receive()` instead of `OnMessage`.
         /// \param host server address or domain name
         /// \param port server port
-        bool Connect(const std::string& host, uint16_t port);
+        /// \return awaitable true if connected, false if connecting or validation failed
+        TCPAsync<bool> ConnectAsync(const std::string& host, uint16_t port);
         
         /// \brief Disconnect from the server, will be called automatically on destruction.
         void Disconnect();
@@ -33,6 +46,18 @@ namespace TCPConn {
         /// \brief Send a message to the server.
         /// \param msg message to send
         void Send(const T& msg) const;
+
+        /// \brief Send a message to the server, its body is moved rather than copied.
+        /// \param msg message to send
+        void Send(T&& msg) const;
+
+        /// \brief Send a message to the server and complete once it has been written, see `ITCPConn::SendAsync`.
+        /// \param msg message to send
+        TCPAsync<void> SendAsync(T msg) const;
+
+        /// \brief Receive the next message from the server, see `ITCPConn::Receive`.
+        /// \return awaitable received message
+        TCPAsync<T> Receive();
         
         /// \brief Get the incoming message queue.
         /// \return reference to the incoming message queue
@@ -47,16 +72,54 @@ namespace TCPConn {
         /// Will block the current thread. Pending signals to terminate.
         void Run();
 
+        /// \brief Get a snapshot of the runtime metrics.
+        /// Callable from any thread, except concurrently with `Connect()` or `Disconnect()`.
+        /// After disconnection the final metrics of the last connection are kept.
+        /// \return counters, queue depths and latencies of the server connection
+        [[nodiscard]] TCPConnStats GetStats() const;
+
+        /// \brief Get the effective socket options of the server connection, see `ITCPConn::GetSocketOptions`.
+        /// Callable from any thread, except concurrently with `Connect()` or `Disconnect()`.
+        /// \return options of the socket, all unset if not connected
+        [[nodiscard]] TCPSocketOptions GetSocketOptions() const;
+
         /// \brief On connected to server.
         virtual void OnConnected() {}
 
         /// \brief On disconnection from server.
         virtual void OnDisconnected() {}
 
+        /// \brief On the outgoing queue reaching `TCPConnConfig::outgoing_high_watermark_bytes`.
+        /// Called on the io thread, producers should hold back messages.
+        virtual void OnBackpressure() {}
+
+        /// \brief On the outgoing queue draining to `TCPConnConfig::outgoing_low_watermark_bytes` after `OnBackpressure`.
+        /// Called on the io thread.
+        virtual void OnWritable() {}
+
+        /// \brief On message received, before it is queued for `Update()`.
+        /// Called on the io thread, keep it short; used by layers such as `ITCPRpcClient` to complete requests.
+        /// \param msg received message, may be moved from when consumed
+        /// \return true to consume the message, false to queue it as usual
+        virtual bool OnMessageIntercept(T& msg) { return false; }
+
+        /// \brief On the server connection closing, by the server or by `Disconnect()`.
+        /// Called on the io thread, or by `Disconnect()` when none runs, before `OnDisconnected`;
+        /// used by layers such as `ITCPRpcClient` to fail requests.
+        virtual void OnConnectionClosed() {}
+
         /// \brief On message received, must be overridden.
         /// \param msg received message
         virtual void OnMessage(T& msg) = 0;
 
+        /// \brief On a batch of messages drained by one `Update()`, in arrival order.
+        /// Override to process the batch at once, by default each message is passed to `OnMessage`.
+        /// Message bodies are recycled once this returns, move them out to keep them.
+        /// \param msgs received messages
+        virtual void OnMessageBatch(std::span<TCPMsgOwned<T>> msgs) {
+            for (auto& msg : msgs) OnMessage(msg.msg);
+        }
+
     private:
         std::unique_ptr<TCPClientImpl<T>> pimpl;
     };
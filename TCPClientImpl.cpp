@@ -13,7 +13,12 @@ namespace TCPConn {
 
     template <typename T>
     ITCPClient<T>::ITCPClient() {
-        pimpl = std::make_unique<TCPClientImpl<T>>(*this);
+        pimpl = std::make_unique<TCPClientImpl<T>>(*this, TCPConnConfig{});
+    }
+
+    template <typename T>
+    ITCPClient<T>::ITCPClient(const TCPConnConfig& config) {
+        pimpl = std::make_unique<TCPClientImpl<T>>(*this, config);
     }
 
     template <typename T>
@@ -24,6 +29,11 @@ namespace TCPConn {
         return pimpl->Connect(host, port);
     }
 
+    template <typename T>
+    TCPAsync<bool> ITCPClient<T>::ConnectAsync(const std::string& host, uint16_t port) {
+        return pimpl->ConnectAsync(host, port);
+    }
+
     template <typename T>
     void ITCPClient<T>::Disconnect() {
         pimpl->Disconnect();
@@ -39,6 +49,21 @@ namespace TCPConn {
         pimpl->Send(msg);
     }
 
+    template <typename T>
+    void ITCPClient<T>::Send(T&& msg) const {
+        pimpl->Send(std::move(msg));
+    }
+
+    template <typename T>
+    TCPAsync<void> ITCPClient<T>::SendAsync(T msg) const {
+        return pimpl->SendAsync(std::move(msg));
+    }
+
+    template <typename T>
+    TCPAsync<T> ITCPClient<T>::Receive() {
+        return pimpl->Receive();
+    }
+
     template <typename T>
     TCPMsgQueue<TCPMsgOwned<T>>& ITCPClient<T>::Incoming() const {
         return pimpl->Incoming();
@@ -54,6 +79,16 @@ namespace TCPConn {
         pimpl->Run();
     }
 
+    template <typename T>
+    TCPConnStats ITCPClient<T>::GetStats() const {
+        return pimpl->GetStats();
+    }
+
+    template <typename T>
+    TCPSocketOptions ITCPClient<T>::GetSocketOptions() const {
+        return pimpl->GetSocketOptions();
+    }
+
 
     /* ----- TCPClientImpl ----- */
 
@@ -61,27 +96,47 @@ namespace TCPConn {
     std::atomic<bool> TCPClientImpl<T>::m_bShuttingDown = false;
     
     template <typename T>
-    TCPClientImpl<T>::TCPClientImpl(ITCPClient<T>& interface)
-        : _interface(interface), m_socket(m_context) {}
+    TCPClientImpl<T>::TCPClientImpl(ITCPClient<T>& interface, const TCPConnConfig& config)
+        : _interface(interface), m_context(IoContextHint()), m_socket(m_context), m_config(config),
+          m_qMessagesIn(config.incoming_queue_mode, config.incoming_queue_capacity),
+          m_bufferPool(config.receive_pool_buffers_per_class) {
+        if constexpr (TCPCONN_IO_URING_ENABLED && std::is_same<T, TCPMsg>::value) {
+            if (config.read_mode == EReadMode::buffered && config.registered_read_buffers > 0)
+                m_pReadSlab = std::make_shared<TCPReadBufferSlab>(m_context, 1,
+                        std::max(config.read_buffer_size, 2 * sizeof(TCPMsgHeader)));
+        }
+    }
 
     template <typename T>
     TCPClientImpl<T>::~TCPClientImpl() {
         m_bIsDestroying = true;
         Disconnect();
+        if (m_pReadSlab) m_pReadSlab->Unregister();
     }
 
     template <typename T>
-    bool TCPClientImpl<T>::Connect(const std::string& host, const uint16_t port) {
+    bool TCPClientImpl<T>::Connect(const std::string& host, const uint16_t port, bool bReceiveDirect,
+                                   const std::function<void(bool)>& OnResultCallback) {
         try {
-            ip::tcp::resolver resolver(m_context);
-            ip::tcp::resolver::results_type endpoint = resolver.resolve(host, std::to_string(port));
+            std::vector<TCPStreamEndpoint> endpoint = ResolveEndpoints(m_context, host, port);
+
+            struct ITCPConn<T>::TCPContext tcp_context{m_context, TCPStreamSocket(m_context), m_bufferPool, m_pReadSlab,
+                                                       IsShmAddress(host)};
+            m_connection = std::make_unique<ITCPConn<T>>(ITCPConn<T>::EOwner::client, tcp_context, 
+                                                          m_qMessagesIn, m_config);
+            m_connection->SetWatermarkCallback([this](bool bBackpressure) {
+                if (bBackpressure) _interface.OnBackpressure();
+                else _interface.OnWritable();
+            });
+            m_connection->SetMessageInterceptor([this](T& msg) { return _interface.OnMessageIntercept(msg); });
+            m_connection->SetCloseCallback([this]() { _interface.OnConnectionClosed(); });
 
-            struct ITCPConn<T>::TCPContext tcp_context{m_context, ip::tcp::socket(m_context)};
-            m_connection = std::make_unique<ITCPConn<T>>(ITCPConn<T>::EOwner::client, tcp_context, m_qMessagesIn);
+            // Set before the io thread starts, so no message reaches the incoming queue
+            if (bReceiveDirect) m_connection->pimpl->EnableReceive();
 
             INFO_MSG("Connecting to {}:{}", host, port);
             struct ITCPConn<T>::TCPEndpoint tcp_endpoint{endpoint};
-            m_connection->ConnectToServer(tcp_endpoint, [this]() { _interface.OnConnected(); });
+            m_connection->ConnectToServer(tcp_endpoint, [this]() { _interface.OnConnected(); }, OnResultCallback);
 
             m_thrContext = std::thread([this]() { m_context.run(); });
             return true;
@@ -91,16 +146,27 @@ namespace TCPConn {
         }
     }
 
+    template <typename T>
+    TCPAsync<bool> TCPClientImpl<T>::ConnectAsync(const std::string& host, uint16_t port) {
+        auto pState = std::make_shared<TCPAsyncState<bool>>();
+        if (!Connect(host, port, true, [pState](bool bConnected) { pState->Complete(bConnected); }))
+            pState->Complete(false);
+        return TCPAsync<bool>(std::move(pState));
+    }
+
     template <typename T>
     void TCPClientImpl<T>::Disconnect() {
-        if (IsConnected()) {
-            m_connection->Disconnect();
+        // Closed on the io thread before it stops, so coroutines awaiting the connection resume there
+        if (m_connection) {
+            if (!m_thrContext.joinable()) m_context.stop();
+            m_connection->pimpl->CloseOnIoThread(std::make_error_code(std::errc::connection_aborted)).wait();
         }
         m_qMessagesIn.exit_wait();
         m_context.stop();
         if (m_thrContext.joinable()) {
             m_thrContext.join();
         }
+        if (m_connection) m_statsLast = m_connection->GetStats();
         m_connection.reset();
         if(!m_bIsDestroying) {
             INFO_MSG("Client disconnected.");
@@ -118,20 +184,52 @@ namespace TCPConn {
         if (IsConnected()) m_connection->Send(msg);
     }
 
+    template <typename T>
+    void TCPClientImpl<T>::Send(T&& msg) const {
+        if (IsConnected()) m_connection->Send(std::move(msg));
+    }
+
+    template <typename T>
+    TCPAsync<void> TCPClientImpl<T>::SendAsync(T&& msg) const {
+        if (m_connection) return m_connection->SendAsync(std::move(msg));
+        auto pState = std::make_shared<TCPAsyncState<void>>();
+        pState->Fail(std::make_error_code(std::errc::not_connected));
+        return TCPAsync<void>(std::move(pState));
+    }
+
+    template <typename T>
+    TCPAsync<T> TCPClientImpl<T>::Receive() {
+        if (m_connection) return m_connection->Receive();
+        auto pState = std::make_shared<TCPAsyncState<T>>();
+        pState->Fail(std::make_error_code(std::errc::not_connected));
+        return TCPAsync<T>(std::move(pState));
+    }
+
     template <typename T>
     TCPMsgQueue<TCPMsgOwned<T>>& TCPClientImpl<T>::Incoming() {
         return m_qMessagesIn;
     }
 
+    template <typename T>
+    TCPConnStats TCPClientImpl<T>::GetStats() {
+        if (m_connection) return m_connection->GetStats();
+        return m_statsLast;
+    }
+
+    template <typename T>
+    TCPSocketOptions TCPClientImpl<T>::GetSocketOptions() const {
+        if (m_connection) return m_connection->GetSocketOptions();
+        return {};
+    }
+
     template <typename T>
     void TCPClientImpl<T>::Update(bool bWait, size_t nMaxMessages) {
         if (bWait) m_qMessagesIn.wait();
-        size_t nMessageCount = 0;
-        while (nMessageCount < nMaxMessages && !m_qMessagesIn.empty()) {
-            auto msg = m_qMessagesIn.pop_front();
-            _interface.OnMessage(msg.msg);
-            nMessageCount++;
-        }
+        // Reused across calls, Update() may run on several threads for locked queues
+        thread_local std::vector<TCPMsgOwned<T>> vecBatch;
+        if (m_qMessagesIn.try_pop_all(vecBatch, nMaxMessages) == 0) return;
+        TCPBatchRelease release(vecBatch, m_bufferPool);
+        _interface.OnMessageBatch(std::span<TCPMsgOwned<T>>(vecBatch));
     }
 
     template<typename T>
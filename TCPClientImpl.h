@@ -6,6 +6,9 @@
 #define TCPCONN_TCPCLIENTIMPL_H
 
 #include "TCPClient.h"
+#include "TCPBufferPool.h"
+#include "TCPIoEngine.h"
+#include "TCPTransport.h"
 #include <boost/asio.hpp>
 #include <thread>
 
@@ -16,26 +19,38 @@ namespace TCPConn {
     template <typename T>
     class TCPClientImpl {
     public:
-        explicit TCPClientImpl(ITCPClient<T>& interface);
+        TCPClientImpl(ITCPClient<T>& interface, const TCPConnConfig& config);
         virtual ~TCPClientImpl();
 
-        bool Connect(const std::string& host, uint16_t port);
+        bool Connect(const std::string& host, uint16_t port, bool bReceiveDirect = false,
+                     const std::function<void(bool)>& OnResultCallback = {});
+        TCPAsync<bool> ConnectAsync(const std::string& host, uint16_t port);
         void Disconnect();
         [[nodiscard]] bool IsConnected() const;
 
         void Send(const T& msg) const;
+        void Send(T&& msg) const;
+        TCPAsync<void> SendAsync(T&& msg) const;
+        TCPAsync<T> Receive();
 
         void Update(bool bWait, size_t nMaxMessages = -1);
         void Run();
 
         TCPMsgQueue<TCPMsgOwned<T>>& Incoming();
 
+        TCPConnStats GetStats();
+        TCPSocketOptions GetSocketOptions() const;
+
     protected:
         io_context m_context;
         std::thread m_thrContext;
-        ip::tcp::socket m_socket;
+        TCPStreamSocket m_socket;
         std::unique_ptr<ITCPConn<T>> m_connection;
         TCPMsgQueue<TCPMsgOwned<T>> m_qMessagesIn;
+        TCPBufferPool m_bufferPool;
+        TCPConnConfig m_config;
+        std::shared_ptr<TCPReadBufferSlab> m_pReadSlab;    // null unless buffered reads run on io_uring
+        TCPConnStats m_statsLast;   // final metrics of the last connection, read on the caller's thread
         bool m_bIsDestroying{};
         static std::atomic<bool> m_bShuttingDown;
 
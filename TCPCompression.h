@@ -0,0 +1,107 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPCOMPRESSION_H
+#define TCPCONN_TCPCOMPRESSION_H
+
+#include "TCPBufferPool.h"
+#include "TCPMsg.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef TCPCONN_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace TCPConn {
+
+#ifdef TCPCONN_HAS_ZLIB
+    inline constexpr bool TCPCONN_COMPRESSION_ENABLED = true;
+#else
+    inline constexpr bool TCPCONN_COMPRESSION_ENABLED = false;
+#endif
+
+    /// \brief Capability bits exchanged during the validation handshake.
+    enum ETCPCaps : uint64_t {
+        TCPCAP_DEFLATE = 1 << 0,        ///< bodies flagged with `TCPMSG_COMPRESSED_FLAG` can be inflated
+        TCPCAP_SHARED_MEMORY = 1 << 1   ///< frames can move to shared memory rings, offered on `shm:` addresses
+    };
+
+    inline constexpr uint64_t TCPCONN_LOCAL_CAPS = TCPCONN_COMPRESSION_ENABLED ? uint64_t(TCPCAP_DEFLATE) : uint64_t(0);
+
+    /// \brief Largest body accepted when inflating, guards against a corrupt size prefix.
+    inline constexpr uint32_t TCPCONN_MAX_INFLATED_SIZE = 1u << 30;
+
+    /// \brief Deflate a body into `[u32 original size][zlib stream]`.
+    /// \param vecIn body to compress
+    /// \param vecOut compressed body
+    /// \param nLevel zlib level from 1 to 9
+    /// \return false if compression is unavailable or would not make the body smaller
+    inline bool DeflateBody(const std::vector<uint8_t>& vecIn, std::vector<uint8_t>& vecOut, int nLevel) {
+#ifdef TCPCONN_HAS_ZLIB
+        if (vecIn.size() > TCPCONN_MAX_INFLATED_SIZE) return false;
+        uLongf nBound = compressBound(uLong(vecIn.size()));
+        vecOut.resize(sizeof(uint32_t) + nBound);
+        auto nOriginal = uint32_t(vecIn.size());
+        std::memcpy(vecOut.data(), &nOriginal, sizeof(uint32_t));
+        if (compress2(vecOut.data() + sizeof(uint32_t), &nBound, vecIn.data(), uLong(vecIn.size()), nLevel) != Z_OK)
+            return false;
+        vecOut.resize(sizeof(uint32_t) + nBound);
+        return vecOut.size() < vecIn.size();
+#else
+        return false;
+#endif
+    }
+
+    /// \brief Deflate the body of a message into a new message flagged with `TCPMSG_COMPRESSED_FLAG`.
+    /// \return nullptr if compression is unavailable or would not make the body smaller
+    inline std::shared_ptr<const TCPMsg> DeflateMsg(const TCPMsg& msg, int nLevel) {
+        auto pCompressed = std::make_shared<TCPMsg>();
+        if (!DeflateBody(msg.body, pCompressed->body, nLevel)) return nullptr;
+        pCompressed->header.type = msg.header.type;
+        pCompressed->header.size = uint32_t(pCompressed->full_size()) | TCPMSG_COMPRESSED_FLAG;
+        return pCompressed;
+    }
+
+    /// \brief Compressed form of one broadcast payload, deflated by the first connection that compresses it
+    /// and shared by the others. Used on the broadcasting thread only.
+    class TCPDeflatedShare {
+    public:
+        std::shared_ptr<const TCPMsg> Get(const TCPMsg& msg, int nLevel) {
+            if (!m_bDone) {
+                m_pMsg = DeflateMsg(msg, nLevel);
+                m_bDone = true;
+            }
+            return m_pMsg;
+        }
+
+    private:
+        bool m_bDone = false;
+        std::shared_ptr<const TCPMsg> m_pMsg;
+    };
+
+    /// \brief Inflate a body produced by `DeflateBody`.
+    /// \param vecIn compressed body
+    /// \param vecOut original body, taken from the pool
+    /// \param pool pool providing the output buffer
+    /// \return false if the body is corrupt or compression is unavailable
+    inline bool InflateBody(const std::vector<uint8_t>& vecIn, std::vector<uint8_t>& vecOut, TCPBufferPool& pool) {
+#ifdef TCPCONN_HAS_ZLIB
+        if (vecIn.size() < sizeof(uint32_t)) return false;
+        uint32_t nOriginal;
+        std::memcpy(&nOriginal, vecIn.data(), sizeof(uint32_t));
+        if (nOriginal > TCPCONN_MAX_INFLATED_SIZE) return false;
+        vecOut = pool.Acquire(nOriginal);
+        auto nLength = uLongf(nOriginal);
+        return uncompress(vecOut.data(), &nLength, vecIn.data() + sizeof(uint32_t), 
+                          uLong(vecIn.size() - sizeof(uint32_t))) == Z_OK && nLength == nOriginal;
+#else
+        return false;
+#endif
+    }
+
+} // TCPConn
+
+#endif //TCPCONN_TCPCOMPRESSION_H
@@ -7,6 +7,9 @@
 
 #include "TCPMsg.h"
 #include "TCPMsgQueue.h"
+#include "TCPConnConfig.h"
+#include "TCPConnStats.h"
+#include "TCPTask.h"
 #include <functional>
 
 enum class MsgTypes;
@@ -16,6 +19,18 @@ namespace TCPConn {
     template <typename T>
     class TCPConnImpl;
 
+    template <typename T>
+    class TCPServerImpl;
+
+    template <typename T>
+    class TCPClientImpl;
+
+    /// \brief Name of the I/O engine the library was built with: "io_uring", "epoll", "kqueue", "iocp" or "select".
+    /// The io_uring engine is opted into with the CMake option `TCPCONN_ENABLE_IO_URING`. It is fixed at build
+    /// time: the epoll fallback only applies when the build host cannot set up an io_uring, and an io_uring build
+    /// run on a kernel without it throws `std::system_error` when a server, client or raw sender is constructed.
+    TCPCONN_API const char* GetIoEngine();
+
     template <typename T>
     class TCPCONN_API ITCPConn : public std::enable_shared_from_this<ITCPConn<T>> {
     public:
@@ -37,21 +52,26 @@ namespace TCPConn {
         /// \param owner owner of the connection, either server or client
         /// \param context asio tcp context reference and socket
         /// \param qIn reference to the incoming message queue of owner
-        ITCPConn(EOwner owner, struct TCPContext& context, TCPMsgQueue<TCPMsgOwned<T>>& qIn);
+        /// \param config connection tunables inherited from the owner
+        ITCPConn(EOwner owner, struct TCPContext& context, TCPMsgQueue<TCPMsgOwned<T>>& qIn,
+                 const TCPConnConfig& config = {});
         virtual ~ITCPConn();
 
         /// \brief Get the connection ID managed by server.
-        /// \return connection ID
-        [[nodiscard]] uint32_t GetID() const;
+        /// \return connection ID, unique for the lifetime of the server
+        [[nodiscard]] uint64_t GetID() const;
 
         
         /// \brief For server to call, connect to a client and start receiving messages.
         /// \param uid client ID to assign to this connection
-        void ConnectToClient(uint32_t uid = 0);
+        void ConnectToClient(uint64_t uid = 0);
         
         /// \brief For client to call, connect to a server.
         /// \param endpoint server endpoint to connect
-        void ConnectToServer(const struct TCPEndpoint &endpoint, const std::function<void()>& OnConnectedCallback);
+        /// \param OnConnectedCallback called once the connection is validated
+        /// \param OnResultCallback called on the io thread with whether connecting and validation succeeded
+        void ConnectToServer(const struct TCPEndpoint &endpoint, const std::function<void()>& OnConnectedCallback,
+                             const std::function<void(bool)>& OnResultCallback = {});
         
         /// \brief Disconnect the connection.
         void Disconnect();
@@ -64,12 +84,67 @@ namespace TCPConn {
         /// \return ip address of the remote endpoint
         [[nodiscard]] std::string GetRemoteEndpoint() const;
 
+        /// \brief Get a snapshot of the runtime metrics, safe to call from any thread.
+        /// \return counters, queue depths and latencies of this connection
+        [[nodiscard]] TCPConnStats GetStats() const;
+
+        /// \brief Get the effective socket options as reported by the kernel, see `TCPConnConfig::socket_options`.
+        /// \return options of the socket, all unset if it is closed
+        [[nodiscard]] TCPSocketOptions GetSocketOptions() const;
+
         
         /// \brief Send a message to the other end.
         /// \param msg message to send
         void Send(const T& msg) const;
+
+        /// \brief Send a message to the other end, its body is moved rather than copied.
+        /// \param msg message to send
+        void Send(T&& msg) const;
+
+        /// \brief Send a shared message to the other end, the payload is referenced rather than copied.
+        /// \param msg message to send, must not be modified afterwards
+        void Send(const TCPMsgShared<T>& msg) const;
+
+        /// \brief Send a message and complete once it has been written to the socket.
+        /// Fails with `std::errc::no_buffer_space` when discarded by the overflow policy and
+        /// `std::errc::connection_aborted` when the connection closes first.
+        /// \param msg message to send
+        TCPAsync<void> SendAsync(const T& msg) const;
+
+        /// \brief Send a message, its body is moved, and complete once it has been written to the socket.
+        /// \param msg message to send
+        TCPAsync<void> SendAsync(T&& msg) const;
+
+        /// \brief Receive the next message of this connection.
+        /// From the first call on, messages of this connection are delivered here instead of the incoming
+        /// queue of the owner; connections from `ITCPServer::Accept` and `ITCPClient::ConnectAsync` start so.
+        /// Only one receive may be pending at a time, fails with `std::errc::connection_aborted` once closed.
+        /// \return awaitable received message
+        TCPAsync<T> Receive();
+
+        /// \brief Change what sending does when the outgoing queue of this connection is full.
+        /// \param policy overflow policy replacing `TCPConnConfig::outgoing_overflow_policy`
+        void SetOverflowPolicy(EOverflowPolicy policy);
+
+        /// \brief Set the callback of the outgoing watermarks, called on the io thread of this connection.
+        /// Must be set before connecting.
+        /// \param callback receives true when the high watermark is reached, false when the low one is reached again
+        void SetWatermarkCallback(const std::function<void(bool bBackpressure)>& callback);
+
+        /// \brief Set a callback seeing every received message before it is queued, called on the io thread
+        /// of this connection. Must be set before connecting.
+        /// \param callback returns true to consume the message, false to pass it on
+        void SetMessageInterceptor(const std::function<bool(T& msg)>& callback);
+
+        /// \brief Set a callback called once when the connection closes, by the peer or locally.
+        /// Called on the io thread of this connection, or on the closing thread once the io threads stopped.
+        /// Must be set before connecting.
+        void SetCloseCallback(const std::function<void()>& callback);
         
     private:
+        friend class TCPServerImpl<T>;
+        friend class TCPClientImpl<T>;
+
         std::unique_ptr<TCPConnImpl<T>> pimpl;
     };
 
@@ -0,0 +1,124 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPCONNCONFIG_H
+#define TCPCONN_TCPCONNCONFIG_H
+
+#include <cstddef>
+#include <memory>
+#include "TCPMsgQueue.h"
+#include "TCPSocketOptions.h"
+
+namespace TCPConn {
+
+    class TCPCaptureRecorder;
+
+    /// \brief How `TCPMsg` frames are read from the socket.
+    enum class EReadMode {
+        exact,      ///< one read for each header and one for each body
+        buffered    ///< read into a per-connection receive buffer and extract every complete frame in it
+    };
+
+    /// \brief What a send does when the outgoing queue of a connection is full.
+    enum class EOverflowPolicy {
+        block,          ///< wait until the queue drains, drops instead when called from an io thread
+        drop_oldest,    ///< queue the new message and discard the oldest ones not yet being written
+        drop_newest,    ///< discard the new message
+        disconnect      ///< discard the new message and close the connection
+    };
+
+    /// \brief Tunables applied to every connection created by a server, client or raw sender.
+    struct TCPConnConfig {
+
+        /// \brief Upper bound of bytes gathered from the outgoing queue into a single write.
+        /// A single message larger than this is still written in one go.
+        size_t max_write_batch_bytes = 1 << 20;
+
+        /// \brief Upper bound of buffers (iovecs) gathered into a single write.
+        /// A `TCPMsg` takes two buffers (header and body), a `TCPRawMsg` takes one.
+        size_t max_write_batch_buffers = 64;
+
+        /// \brief Read strategy of `TCPMsg` connections, `buffered` favours many small messages.
+        EReadMode read_mode = EReadMode::exact;
+
+        /// \brief Size of the per-connection receive buffer in `EReadMode::buffered`.
+        /// Frames larger than the buffer are completed with a direct read into the message body.
+        size_t read_buffer_size = 64 * 1024;
+
+        /// \brief Receive buffers of `EReadMode::buffered` registered with the kernel per server, on the io_uring engine.
+        /// Reads into them are fixed-buffer reads, connections beyond this number use plain buffers.
+        /// A client registers one. Ignored on other engines, see `GetIoEngine()`.
+        size_t registered_read_buffers = 256;
+
+        /// \brief Storage of the incoming message queue drained by `Update()`.
+        /// Ring modes require `Update()` to be called from a single thread; use `spsc` for clients
+        /// and `mpsc` for servers. A full ring stalls reading until the consumer catches up.
+        EQueueMode incoming_queue_mode = EQueueMode::locked;
+
+        /// \brief Capacity of the incoming ring in messages, ignored for `EQueueMode::locked`.
+        size_t incoming_queue_capacity = 4096;
+
+        /// \brief Received message bodies kept for reuse per size class (64 B to 16 MB).
+        /// Bodies are recycled once `OnMessage` returns, 0 disables pooling.
+        size_t receive_pool_buffers_per_class = 64;
+
+        /// \brief Number of threads running the server io_context.
+        /// Each connection is bound to its own strand, so the handlers of one connection stay serialised
+        /// while different connections are served in parallel. Combine with `EQueueMode::mpsc` or `locked`.
+        /// Server callbacks for different clients may then run concurrently.
+        size_t io_threads = 1;
+
+        /// \brief Number of server threads running `OnMessage`, 0 runs it on the thread calling `Update()`.
+        /// `Update()` then only hands messages over: the messages of one client are handled in order by one
+        /// thread at a time, while different clients are handled in parallel and idle threads take over
+        /// clients queued on busy ones. `OnMessageBatch` receives the messages of a single client.
+        /// An exception thrown by a handler on these threads drops the rest of its batch, the thread keeps
+        /// running and the next `Update()` rethrows it; further ones thrown before that are logged.
+        size_t dispatch_threads = 0;
+
+        /// \brief Messages queued for writing per connection before `outgoing_overflow_policy` applies, 0 for unbounded.
+        size_t max_outgoing_messages = 0;
+
+        /// \brief Bytes queued for writing per connection before `outgoing_overflow_policy` applies, 0 for unbounded.
+        /// A single message larger than this is still accepted into an empty queue.
+        size_t max_outgoing_bytes = 0;
+
+        /// \brief Policy of a full outgoing queue, can be changed per connection with `ITCPConn::SetOverflowPolicy`.
+        EOverflowPolicy outgoing_overflow_policy = EOverflowPolicy::drop_newest;
+
+        /// \brief Queued bytes at which `OnBackpressure` is called, 0 disables the watermark callbacks.
+        size_t outgoing_high_watermark_bytes = 0;
+
+        /// \brief Queued bytes at or below which `OnWritable` is called after `OnBackpressure`.
+        size_t outgoing_low_watermark_bytes = 0;
+
+        /// \brief zlib level (1 fastest to 9 smallest) of `TCPMsg` bodies sent, 0 disables compression.
+        /// Only applied when the peer announced during validation that it can inflate bodies.
+        int compression_level = 0;
+
+        /// \brief Bodies smaller than this are always sent uncompressed.
+        size_t compression_threshold_bytes = 4096;
+
+        /// \brief Bytes of the ring in each direction of a `shm:` connection, rounded up to a power of two.
+        /// Set by the server, which creates the segment. Frames larger than the ring pass through it in pieces.
+        size_t shm_ring_bytes = 4 << 20;
+
+        /// \brief Microseconds a `shm:` connection polls its ring for more frames before sleeping on its eventfd.
+        /// Polling saves the wakeup per message at the cost of a busy io thread, so it pays off with spare cores
+        /// for the io threads of both sides; 0 sleeps at once.
+        size_t shm_spin_us = 0;
+
+        /// \brief Socket options applied on accept and connect, e.g. `TCPSocketOptions::LowLatency()`.
+        /// Left empty, sockets keep the system defaults.
+        TCPSocketOptions socket_options{};
+
+        /// \brief Recorder every message received and sent is appended to, e.g.
+        /// `std::make_shared<TCPCaptureRecorder>("session.tcap")`. Shared by all connections, include
+        /// "TCPCapture.h" to create one and "TCPCaptureReplay.h" to play a capture back. Left empty, nothing is recorded.
+        std::shared_ptr<TCPCaptureRecorder> capture{};
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPCONNCONFIG_H
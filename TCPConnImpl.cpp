@@ -7,22 +7,24 @@
 #include "TCPConn.h"
 
 #define RAW_RECEIVE_BUFFER_SIZE 1024
+#define SHM_READ_BATCH 256
 
 namespace TCPConn {
 
     /* ----- ITCPConn ----- */
     
     template <typename T>
-    ITCPConn<T>::ITCPConn(ITCPConn<T>::EOwner owner, struct ITCPConn::TCPContext& context, TCPMsgQueue<TCPMsgOwned<T>>& qIn)
+    ITCPConn<T>::ITCPConn(ITCPConn<T>::EOwner owner, struct ITCPConn::TCPContext& context, TCPMsgQueue<TCPMsgOwned<T>>& qIn,
+                          const TCPConnConfig& config)
     {
-        pimpl = std::make_unique<TCPConnImpl<T>>(*this, owner, context, qIn);
+        pimpl = std::make_unique<TCPConnImpl<T>>(*this, owner, context, qIn, config);
     }
     
     template <typename T>
     ITCPConn<T>::~ITCPConn() = default;
 
     template <typename T>
-    uint32_t ITCPConn<T>::GetID() const {
+    uint64_t ITCPConn<T>::GetID() const {
         return pimpl->GetID();
     }
     
@@ -32,14 +34,25 @@ namespace TCPConn {
     }
 
     template <typename T>
-    void ITCPConn<T>::ConnectToClient(uint32_t uid) {
+    TCPConnStats ITCPConn<T>::GetStats() const {
+        return pimpl->GetStats();
+    }
+
+    template <typename T>
+    TCPSocketOptions ITCPConn<T>::GetSocketOptions() const {
+        return pimpl->GetSocketOptions();
+    }
+
+    template <typename T>
+    void ITCPConn<T>::ConnectToClient(uint64_t uid) {
         pimpl->ConnectToClient(uid);
     }
 
     template <typename T>
     void ITCPConn<T>::ConnectToServer(const ITCPConn::TCPEndpoint &endpoint,
-                                      const std::function<void()> &OnConnectedCallback) {
-        pimpl->ConnectToServer(endpoint, OnConnectedCallback);
+                                      const std::function<void()> &OnConnectedCallback,
+                                      const std::function<void(bool)> &OnResultCallback) {
+        pimpl->ConnectToServer(endpoint, OnConnectedCallback, OnResultCallback);
     }
     
     template <typename T>
@@ -57,67 +70,165 @@ namespace TCPConn {
         pimpl->Send(msg);
     }
 
+    template <typename T>
+    void ITCPConn<T>::Send(T&& msg) const {
+        pimpl->Send(std::move(msg));
+    }
+
+    template <typename T>
+    void ITCPConn<T>::Send(const TCPMsgShared<T>& msg) const {
+        pimpl->Send(msg);
+    }
+
+    template <typename T>
+    TCPAsync<void> ITCPConn<T>::SendAsync(const T& msg) const {
+        return pimpl->SendAsync(T(msg));
+    }
+
+    template <typename T>
+    TCPAsync<void> ITCPConn<T>::SendAsync(T&& msg) const {
+        return pimpl->SendAsync(std::move(msg));
+    }
+
+    template <typename T>
+    TCPAsync<T> ITCPConn<T>::Receive() {
+        return pimpl->Receive();
+    }
+
+    template <typename T>
+    void ITCPConn<T>::SetOverflowPolicy(EOverflowPolicy policy) {
+        pimpl->SetOverflowPolicy(policy);
+    }
+
+    template <typename T>
+    void ITCPConn<T>::SetWatermarkCallback(const std::function<void(bool)>& callback) {
+        pimpl->SetWatermarkCallback(callback);
+    }
+
+    template <typename T>
+    void ITCPConn<T>::SetCloseCallback(const std::function<void()>& callback) {
+        pimpl->SetCloseCallback(callback);
+    }
+
+    template <typename T>
+    void ITCPConn<T>::SetMessageInterceptor(const std::function<bool(T&)>& callback) {
+        pimpl->SetMessageInterceptor(callback);
+    }
+
+
+    const char* GetIoEngine() {
+#if defined TCPCONN_HAS_IO_URING
+        return "io_uring";
+#elif defined BOOST_ASIO_HAS_IOCP
+        return "iocp";
+#elif defined BOOST_ASIO_HAS_EPOLL
+        return "epoll";
+#elif defined BOOST_ASIO_HAS_KQUEUE
+        return "kqueue";
+#else
+        return "select";
+#endif
+    }
+
 
     /* ----- TCPConnImpl ----- */
     
     template <typename T>
-    TCPConnImpl<T>::TCPConnImpl(ITCPConn<T>& interface, ITCPConn<T>::EOwner owner, struct ITCPConn<T>::TCPContext& context, TCPMsgQueue<TCPMsgOwned<T>>& qIn)
-        : _interface(interface), m_context(context.context), m_socket(std::move(context.socket)), m_qMessagesIn(qIn)
+    TCPConnImpl<T>::TCPConnImpl(ITCPConn<T>& interface, ITCPConn<T>::EOwner owner, struct ITCPConn<T>::TCPContext& context, 
+                                TCPMsgQueue<TCPMsgOwned<T>>& qIn, const TCPConnConfig& config)
+        : _interface(interface), m_context(context.context), m_socket(std::move(context.socket)), m_qMessagesIn(qIn),
+          m_bufferPool(context.pool), m_config(config), m_limiter(config),
+          m_pReadSlab(context.slab)
     {
         m_eOwnerType = owner;
         if (m_eOwnerType == ITCPConn<T>::EOwner::server) {
-            m_nValidationOut = uint64_t(std::chrono::system_clock::now().time_since_epoch().count());
+            m_nValidationOut = MarkCapsChallenge(uint64_t(std::chrono::system_clock::now().time_since_epoch().count()));
             m_nValidationCheck = CalculateValidation(m_nValidationOut);
         }
+        if constexpr (TCPCONN_SHM_ENABLED && std::is_same<T, TCPMsg>::value) {
+            if (context.shared_memory) m_nCapsOut |= TCPCAP_SHARED_MEMORY;
+        }
     }
     
     template <typename T>
-    TCPConnImpl<T>::~TCPConnImpl() = default;
+    TCPConnImpl<T>::~TCPConnImpl() {
+        FailAwaiters(std::make_error_code(std::errc::operation_canceled));
+        if (m_nReadSlot >= 0) m_pReadSlab->Release(m_nReadSlot);
+    }
 
     template <typename T>
-    uint32_t TCPConnImpl<T>::GetID() const {
+    uint64_t TCPConnImpl<T>::GetID() const {
         return id;
     }
     
     template<typename T>
     std::string TCPConnImpl<T>::GetRemoteEndpoint() const {
-        return std::move(m_socket.remote_endpoint().address().to_string());
+        return EndpointToString(m_socket.remote_endpoint());
+    }
+
+    template <typename T>
+    TCPConnStats TCPConnImpl<T>::GetStats() const {
+        TCPConnStats stats = m_stats.Snapshot();
+        if constexpr (TCPCONN_STATS_ENABLED) {
+            stats.incoming_queue_depth = m_qMessagesIn.count();
+            stats.messages_dropped = m_limiter.DroppedMessages();
+            stats.compression_negotiated = m_bCompress.load(std::memory_order_relaxed);
+        }
+        return stats;
     }
 
     template <typename T>
-    void TCPConnImpl<T>::ConnectToClient(uint32_t uid)  {
+    TCPSocketOptions TCPConnImpl<T>::GetSocketOptions() const {
+        return ReadSocketOptions(m_socket);
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::ConnectToClient(uint64_t uid)  {
         if (m_eOwnerType == ITCPConn<T>::EOwner::server) {
             if (m_socket.is_open()) {
                 id = uid;
+                ApplySocketOptions(m_socket, m_config.socket_options);
+                m_bQuickAck = m_config.socket_options.quick_ack.value_or(false) && IsTcpSocket(m_socket);
+                m_stats.HandshakeStarted();
                 if constexpr (std::is_same<T, TCPMsg>::value) {
                     WriteValidation();
                     ReadValidation(); 
                 }
-                else if constexpr (std::is_same<T, TCPRawMsg>::value) ReadRaw();
+                else if constexpr (std::is_same<T, TCPRawMsg>::value) {
+                    m_stats.HandshakeDone();
+                    ReadRaw();
+                }
             }
         } else
             ERROR_MSG("Cannot connect client to client!");
     }
 
     template <typename T>
-    void TCPConnImpl<T>::ConnectToServer(const struct ITCPConn<T>::TCPEndpoint &endpoint, const std::function<void()>& OnConnectedCallback) {
+    void TCPConnImpl<T>::ConnectToServer(const struct ITCPConn<T>::TCPEndpoint &endpoint, const std::function<void()>& OnConnectedCallback,
+                                         const std::function<void(bool)>& OnResultCallback) {
         if (IsConnected()) 
             ERROR_MSG("Already connected.");
         if (m_eOwnerType == ITCPConn<T>::EOwner::client) {
+            m_fnConnectResult = OnResultCallback;
+            m_stats.HandshakeStarted();
             async_connect(m_socket, endpoint.endpoint,
-                          [this, OnConnectedCallback](std::error_code ec, ip::tcp::endpoint endpoint) {
+                          [this, OnConnectedCallback](std::error_code ec, const TCPStreamEndpoint& endpoint) {
                               if (!ec) {
-                                  INFO_MSG("Connected to server at {}", endpoint.address().to_string());
+                                  INFO_MSG("Connected to server at {}", EndpointToString(endpoint));
+                                  ApplySocketOptions(m_socket, m_config.socket_options);
+                                  m_bQuickAck = m_config.socket_options.quick_ack.value_or(false) && IsTcpSocket(m_socket);
                                   if constexpr (std::is_same<T, TCPMsg>::value) {
                                       ReadValidation(OnConnectedCallback);
                                   }
                                   else if constexpr (std::is_same<T, TCPRawMsg>::value) {
+                                      m_stats.HandshakeDone();
                                       auto async_call = std::async(std::launch::async, OnConnectedCallback);
                                       ReadRaw();
+                                      NotifyConnectResult(true);
                                   }
                               } else {
                                   INFO_MSG("Connect fail: {}", ec.message());
-                                  m_socket.close();
+                                  CloseSocket();
                               }
                           });
         } else
@@ -127,7 +238,7 @@ namespace TCPConn {
     template <typename T>
     void TCPConnImpl<T>::Disconnect()  {
         if (IsConnected()) 
-            post(m_context, [this]() { m_socket.close(); });
+            post(m_socket.get_executor(), [this]() { CloseSocket(); });
     }
 
     template <typename T>
@@ -137,36 +248,166 @@ namespace TCPConn {
 
     template <typename T>
     void TCPConnImpl<T>::Send(const T& msg) {
-        if constexpr (std::is_same<T, TCPMsg>::value)
-            post(m_context,
-                 [this, msg]() {
-                     bool bWritingMessage = !m_qMessagesOut.empty();
-                     m_qMessagesOut.push_back(msg);
-                     if (!bWritingMessage) {
-                         WriteHeader();
-                     }
-                 });
-        else if constexpr (std::is_same<T, TCPRawMsg>::value) 
-            post(m_context,
-                 [this, msg]() {
-                     bool bWritingMessage = !m_qMessagesOut.empty();
-                     m_qMessagesOut.push_back(msg);
-                     if (!bWritingMessage) {
-                         WriteRaw();
-                     }
-                 });
+        Send(std::make_shared<const T>(msg));
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::Send(T&& msg) {
+        Send(std::make_shared<const T>(std::move(msg)));
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::Send(const TCPMsgShared<T>& msgIn, std::shared_ptr<TCPAsyncState<void>> pWaiter,
+                              TCPDeflatedShare* pDeflated) {
+        if (m_config.capture) m_config.capture->Record(ECaptureDirection::outbound, CaptureID(), *msgIn);
+        // Written straight into the shared memory ring when it has room and nothing is queued ahead
+        bool bShm = m_bShm.load(std::memory_order_acquire);
+        if (bShm && TrySendShm(*msgIn)) {
+            if (pWaiter) pWaiter->Complete();
+            return;
+        }
+        // Compressed on the sending thread, the io thread only writes the smaller body
+        TCPMsgShared<T> msg = msgIn;
+        size_t nRawBody = 0;
+        if constexpr (std::is_same<T, TCPMsg>::value) {
+            if (m_bCompress.load(std::memory_order_relaxed) && msgIn->body.size() >= m_config.compression_threshold_bytes) {
+                auto pCompressed = pDeflated ? pDeflated->Get(*msgIn, m_config.compression_level)
+                                             : DeflateMsg(*msgIn, m_config.compression_level);
+                if (pCompressed) {
+                    nRawBody = msgIn->body.size();
+                    msg = std::move(pCompressed);
+                }
+            }
+        }
+        // Blocking an io thread could stall the very writes that free the queue
+        bool bCanBlock = !m_context.get_executor().running_in_this_thread();
+        switch (m_limiter.Admit(msg->full_size(), bCanBlock, [this]() { return IsConnected(); })) {
+            case TCPOutgoingLimiter::EAdmit::queue:
+                break;
+            case TCPOutgoingLimiter::EAdmit::drop:
+                if (bShm) UnqueueShm();
+                if (pWaiter) pWaiter->Fail(std::make_error_code(std::errc::no_buffer_space));
+                return;
+            case TCPOutgoingLimiter::EAdmit::disconnect:
+                if (m_eOwnerType == ITCPConn<T>::EOwner::server)
+                    INFO_MSG("[Client {:02}] Outgoing queue full, closing connection.", id);
+                else
+                    INFO_MSG("Outgoing queue to server full, closing connection.");
+                if (bShm) UnqueueShm();
+                Disconnect();
+                if (pWaiter) pWaiter->Fail(std::make_error_code(std::errc::connection_aborted));
+                return;
+        }
+        post(m_socket.get_executor(),
+             [this, msg, nRawBody, bShm, pWaiter = std::move(pWaiter)]() {
+                 if (nRawBody > 0) m_stats.Compressed(nRawBody, msg->body.size());
+                 // Sent before shared memory was negotiated, counted once it reaches the queue
+                 if (!bShm && m_bShm) CountShm(1);
+                 bool bWritingMessage = !m_qMessagesOut.empty();
+                 m_qMessagesOut.push_back(msg);
+                 if (pWaiter) {
+                     if (m_socket.is_open()) m_qWriteWaiters.emplace_back(msg.get(), pWaiter);
+                     else pWaiter->Fail(std::make_error_code(std::errc::connection_aborted));
+                 }
+                 if (bWritingMessage) TrimOutgoingMessages();
+                 m_stats.OutgoingDepth(m_qMessagesOut.size());
+                 NotifyWatermarks();
+                 if (!bWritingMessage) {
+                     WriteMessages();
+                 }
+             });
+    }
+
+    template <typename T>
+    TCPAsync<void> TCPConnImpl<T>::SendAsync(T&& msg) {
+        auto pState = std::make_shared<TCPAsyncState<void>>();
+        Send(std::make_shared<const T>(std::move(msg)), pState);
+        return TCPAsync<void>(std::move(pState));
+    }
+
+    template <typename T>
+    TCPAsync<T> TCPConnImpl<T>::Receive() {
+        auto pState = std::make_shared<TCPAsyncState<T>>();
+        // Runs in place when already on the io thread of this connection
+        dispatch(m_socket.get_executor(), [this, pState]() {
+            m_bReceiveDirect = true;
+            if (!m_qReceived.empty()) {
+                T msg = std::move(m_qReceived.front());
+                m_qReceived.pop_front();
+                pState->Complete(std::move(msg));
+            } else if (m_pReceiveWaiter) {
+                pState->Fail(std::make_error_code(std::errc::operation_in_progress));
+            } else if (!m_socket.is_open()) {
+                pState->Fail(std::make_error_code(std::errc::connection_aborted));
+            } else {
+                m_pReceiveWaiter = pState;
+            }
+        });
+        return TCPAsync<T>(std::move(pState));
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::SetOverflowPolicy(EOverflowPolicy policy) {
+        m_limiter.SetPolicy(policy);
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::SetWatermarkCallback(const std::function<void(bool)>& callback) {
+        m_fnWatermark = callback;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::SetCloseCallback(const std::function<void()>& callback) {
+        m_fnClose = callback;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::SetMessageInterceptor(const std::function<bool(T&)>& callback) {
+        m_fnIntercept = callback;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::TrimOutgoingMessages() {
+        if (m_limiter.GetPolicy() != EOverflowPolicy::drop_oldest) return;
+        // The first m_nMessagesWriting messages are referenced by the write in flight, the newest is kept
+        while (m_limiter.OverLimit() && m_qMessagesOut.size() > m_nMessagesWriting + 1) {
+            auto it = m_qMessagesOut.begin() + std::ptrdiff_t(m_nMessagesWriting);
+            const T* pDropped = it->get();
+            m_limiter.Dropped(pDropped->full_size());
+            m_qMessagesOut.erase(it);
+            if (m_bShm) UnqueueShm();
+            auto itWaiter = std::find_if(m_qWriteWaiters.begin(), m_qWriteWaiters.end(),
+                                         [pDropped](const auto& waiter) { return waiter.first == pDropped; });
+            if (itWaiter != m_qWriteWaiters.end()) {
+                auto pWaiter = std::move(itWaiter->second);
+                m_qWriteWaiters.erase(itWaiter);
+                pWaiter->Fail(std::make_error_code(std::errc::no_buffer_space));
+            }
+        }
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::NotifyWatermarks() {
+        int nCrossed = m_limiter.CheckWatermarks();
+        if (nCrossed != 0 && m_fnWatermark) m_fnWatermark(nCrossed > 0);
     }
 
     template <typename T>
     void TCPConnImpl<T>::ReadHeader()  {
-        if constexpr (std::is_same<T, TCPMsg>::value)
+        if constexpr (std::is_same<T, TCPMsg>::value) {
+            if (m_bQuickAck) RearmQuickAck(m_socket);
+            if (m_config.read_mode == EReadMode::buffered) {
+                ReadBuffered();
+                return;
+            }
             async_read(m_socket, buffer(&m_msgTemporaryIn.header, sizeof(TCPMsgHeader)),
                        [this](std::error_code ec, std::size_t length) {
                            if (!ec) {
-                               if (m_msgTemporaryIn.header.size > 0) {
-                                   m_msgTemporaryIn.body.resize(m_msgTemporaryIn.header.size - sizeof(TCPMsgHeader));
+                               if (size_t nBody = BodySize(m_msgTemporaryIn.header); nBody > 0) {
+                                   m_msgTemporaryIn.body = m_bufferPool.Acquire(nBody);
                                    ReadBody();
                                } else {
+                                   m_msgTemporaryIn.body.clear();
                                    AddToIncomingMessageQueue();
                                }
                            } else {
@@ -174,9 +415,10 @@ namespace TCPConn {
                                    INFO_MSG("[Client {:02}] Read header fail, closing connection.", id);
                                else
                                    INFO_MSG("Read header from server fail, closing connection.");
-                               m_socket.close();
+                               CloseSocket();
                            }
                        });
+        }
     }
 
     template <typename T>
@@ -191,62 +433,204 @@ namespace TCPConn {
                                    INFO_MSG("[Client {:02}] Read body fail, closing connection.", id);
                                else
                                    INFO_MSG("Read body from server fail, closing connection.");
-                               m_socket.close();
+                               CloseSocket();
                            }
                        });
     }
 
     template <typename T>
-    void TCPConnImpl<T>::WriteHeader() {
-        if constexpr (std::is_same<T, TCPMsg>::value) 
-            async_write(m_socket, buffer(&m_qMessagesOut.front().header, sizeof(TCPMsgHeader)),
-                        [this](std::error_code ec, std::size_t length) {
-                            if (!ec) {
-                                if (m_qMessagesOut.front().body.size() > 0) {
-                                    WriteBody();
-                                } else {
-                                    m_qMessagesOut.pop_front();
-                                    if (!m_qMessagesOut.empty()) {
-                                        WriteHeader();
-                                    }
-                                }
-                            } else {
-                                if (m_eOwnerType == ITCPConn<T>::EOwner::server)
-                                    INFO_MSG("[Client {:02}] Write header fail, closing connection.", id);
-                                else
-                                    INFO_MSG("Write header to server fail, closing connection.");
-                                m_socket.close();
-                            }
-                        });
+    void TCPConnImpl<T>::ReadBuffered() {
+        if constexpr (std::is_same<T, TCPMsg>::value) {
+            if (!m_pReadBuffer) {
+                if (m_pReadSlab && (m_nReadSlot = m_pReadSlab->Acquire()) >= 0) {
+                    m_pReadBuffer = m_pReadSlab->Data(m_nReadSlot);
+                    m_nReadBufferSize = m_pReadSlab->SlotSize();
+                } else {
+                    m_vecReadBuffer.resize(std::max(m_config.read_buffer_size, 2 * sizeof(TCPMsgHeader)));
+                    m_pReadBuffer = m_vecReadBuffer.data();
+                    m_nReadBufferSize = m_vecReadBuffer.size();
+                }
+            }
+            
+            // Extract every complete frame already in the buffer
+            size_t nNeeded = sizeof(TCPMsgHeader);
+            while (m_nReadEnd - m_nReadBegin >= sizeof(TCPMsgHeader)) {
+                auto& header = m_msgTemporaryIn.header;
+                std::memcpy(&header, m_pReadBuffer + m_nReadBegin, sizeof(TCPMsgHeader));
+                size_t nBody = BodySize(header);
+                size_t nAvailable = m_nReadEnd - m_nReadBegin - sizeof(TCPMsgHeader);
+                
+                if (nBody > nAvailable && sizeof(TCPMsgHeader) + nBody > m_nReadBufferSize) {
+                    // Frame larger than the buffer, read the remainder straight into the body
+                    m_msgTemporaryIn.body = m_bufferPool.Acquire(nBody);
+                    std::memcpy(m_msgTemporaryIn.body.data(), 
+                                m_pReadBuffer + m_nReadBegin + sizeof(TCPMsgHeader), nAvailable);
+                    m_nReadBegin = m_nReadEnd = 0;
+                    async_read(m_socket, buffer(m_msgTemporaryIn.body.data() + nAvailable, nBody - nAvailable),
+                               [this](std::error_code ec, std::size_t length) {
+                                   if (!ec) {
+                                       AddToIncomingMessageQueue();
+                                   } else {
+                                       if (m_eOwnerType == ITCPConn<T>::EOwner::server)
+                                           INFO_MSG("[Client {:02}] Read body fail, closing connection.", id);
+                                       else
+                                           INFO_MSG("Read body from server fail, closing connection.");
+                                       CloseSocket();
+                                   }
+                               });
+                    return;
+                }
+                if (nBody > nAvailable) {
+                    nNeeded = sizeof(TCPMsgHeader) + nBody;
+                    break;
+                }
+                
+                m_nReadBegin += sizeof(TCPMsgHeader);
+                if (nBody > 0) {
+                    m_msgTemporaryIn.body = m_bufferPool.Acquire(nBody);
+                    std::memcpy(m_msgTemporaryIn.body.data(), m_pReadBuffer + m_nReadBegin, nBody);
+                    m_nReadBegin += nBody;
+                } else {
+                    m_msgTemporaryIn.body.clear();
+                }
+                PushToIncomingMessageQueue();
+            }
+            
+            // Keep the pending partial frame at the front when it would not fit behind it
+            if (m_nReadBegin == m_nReadEnd) {
+                m_nReadBegin = m_nReadEnd = 0;
+            } else if (m_nReadBegin + nNeeded > m_nReadBufferSize) {
+                std::memmove(m_pReadBuffer, m_pReadBuffer + m_nReadBegin, m_nReadEnd - m_nReadBegin);
+                m_nReadEnd -= m_nReadBegin;
+                m_nReadBegin = 0;
+            }
+            
+            auto OnRead = [this](std::error_code ec, std::size_t length) {
+                if (!ec) {
+                    m_nReadEnd += length;
+                    ReadBuffered();
+                } else {
+                    if (m_eOwnerType == ITCPConn<T>::EOwner::server)
+                        INFO_MSG("[Client {:02}] Read fail, closing connection.", id);
+                    else
+                        INFO_MSG("Read from server fail, closing connection.");
+                    CloseSocket();
+                }
+            };
+#ifdef TCPCONN_HAS_IO_URING
+            if (m_nReadSlot >= 0 && m_pReadSlab->Registered()) {
+                // Fixed-buffer read, the kernel already holds the pages of the slab
+                m_socket.async_read_some(m_pReadSlab->Buffer(m_nReadSlot, m_nReadEnd), std::move(OnRead));
+                return;
+            }
+#endif
+            m_socket.async_read_some(buffer(m_pReadBuffer + m_nReadEnd, m_nReadBufferSize - m_nReadEnd), std::move(OnRead));
+        }
     }
 
     template <typename T>
-    void TCPConnImpl<T>::WriteBody() {
-        if constexpr (std::is_same<T, TCPMsg>::value)
-            async_write(m_socket, buffer(m_qMessagesOut.front().body.data(), m_qMessagesOut.front().body.size()),
-                        [this](std::error_code ec, std::size_t length) {
-                            if (!ec) {
-                                m_qMessagesOut.pop_front();
-                                if (!m_qMessagesOut.empty()) {
-                                    WriteHeader();
-                                }
-                            } else {
-                                if (m_eOwnerType == ITCPConn<T>::EOwner::server)
-                                    INFO_MSG("[Client {:02}] Write body fail, closing connection.", id);
-                                else
-                                    INFO_MSG("Write body to server fail, closing connection.");
-                                m_socket.close();
+    void TCPConnImpl<T>::WriteMessages() {
+        if (m_bShm) {
+            WriteShm();
+            return;
+        }
+        // Gather as many queued messages as the batch limits allow into one write,
+        // each TCPMsg contributing its header and body as separate buffers.
+        m_vecWriteBuffers.clear();
+        m_nMessagesWriting = 0;
+        size_t nBatchBytes = 0;
+        for (const auto& pMsg : m_qMessagesOut) {
+            const T& msg = *pMsg;
+            size_t nBuffers = msg.body.empty() ? 0 : 1;
+            if constexpr (std::is_same<T, TCPMsg>::value) nBuffers++;
+            if (m_nMessagesWriting > 0 &&
+                (nBatchBytes + msg.full_size() > m_config.max_write_batch_bytes ||
+                 m_vecWriteBuffers.size() + nBuffers > m_config.max_write_batch_buffers))
+                break;
+            if constexpr (std::is_same<T, TCPMsg>::value)
+                m_vecWriteBuffers.emplace_back(&msg.header, sizeof(TCPMsgHeader));
+            if (!msg.body.empty())
+                m_vecWriteBuffers.emplace_back(msg.body.data(), msg.body.size());
+            nBatchBytes += msg.full_size();
+            m_nMessagesWriting++;
+        }
+        m_tWriteStart = TCPConnStatsRecorder::Now();
+        async_write(m_socket, m_vecWriteBuffers,
+                    [this](std::error_code ec, std::size_t length) {
+                        if (!ec) {
+                            m_stats.Written(m_nMessagesWriting, length, m_tWriteStart);
+                            // Waiters of the written messages are completed once the queue is consistent again
+                            std::vector<std::shared_ptr<TCPAsyncState<void>>> vecWritten;
+                            for (size_t i = 0; i < m_nMessagesWriting && !m_qWriteWaiters.empty(); i++) {
+                                if (m_qWriteWaiters.front().first != m_qMessagesOut[i].get()) continue;
+                                vecWritten.push_back(std::move(m_qWriteWaiters.front().second));
+                                m_qWriteWaiters.pop_front();
                             }
-                        });
+                            m_qMessagesOut.erase(m_qMessagesOut.begin(), 
+                                                 m_qMessagesOut.begin() + std::ptrdiff_t(m_nMessagesWriting));
+                            if (m_bShm) UnqueueShm(m_nMessagesWriting);
+                            m_stats.OutgoingDepth(m_qMessagesOut.size());
+                            m_limiter.Release(m_nMessagesWriting, length);
+                            NotifyWatermarks();
+                            if (!m_qMessagesOut.empty()) {
+                                WriteMessages();
+                            }
+                            for (auto& pWaiter : vecWritten) pWaiter->Complete();
+                        } else {
+                            if (m_eOwnerType == ITCPConn<T>::EOwner::server)
+                                INFO_MSG("[Client {:02}] Write message fail, closing connection.", id);
+                            else
+                                INFO_MSG("Write message to server fail, closing connection.");
+                            CloseSocket();
+                        }
+                    });
     }
 
     template <typename T>
-    void TCPConnImpl<T>::AddToIncomingMessageQueue() {
+    size_t TCPConnImpl<T>::BodySize(const TCPMsgHeader& header) {
+        size_t nSize = header.size & ~TCPMSG_COMPRESSED_FLAG;
+        return nSize > sizeof(TCPMsgHeader) ? nSize - sizeof(TCPMsgHeader) : 0;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::PushToIncomingMessageQueue() {
+        m_stats.Received(m_msgTemporaryIn.full_size());
+        if constexpr (std::is_same<T, TCPMsg>::value) {
+            if (m_msgTemporaryIn.header.size & TCPMSG_COMPRESSED_FLAG) {
+                std::vector<uint8_t> vecInflated;
+                if (!InflateBody(m_msgTemporaryIn.body, vecInflated, m_bufferPool)) {
+                    if (m_eOwnerType == ITCPConn<T>::EOwner::server)
+                        ERROR_MSG("[Client {:02}] Inflate body fail, closing connection.", id);
+                    else
+                        ERROR_MSG("Inflate body from server fail, closing connection.");
+                    m_bufferPool.Release(std::move(vecInflated));
+                    CloseSocket();
+                    return;
+                }
+                m_bufferPool.Release(std::move(m_msgTemporaryIn.body));
+                m_msgTemporaryIn.body = std::move(vecInflated);
+                m_msgTemporaryIn.header.size = uint32_t(m_msgTemporaryIn.full_size());
+            }
+        }
+        if (m_config.capture) m_config.capture->Record(ECaptureDirection::inbound, CaptureID(), m_msgTemporaryIn);
+        if (m_fnIntercept && m_fnIntercept(m_msgTemporaryIn)) return;
+        if (m_bReceiveDirect) {
+            if (auto pWaiter = std::exchange(m_pReceiveWaiter, nullptr))
+                pWaiter->Complete(std::move(m_msgTemporaryIn));
+            else
+                m_qReceived.push_back(std::move(m_msgTemporaryIn));
+            return;
+        }
         if (m_eOwnerType == ITCPConn<T>::EOwner::server) {
-            m_qMessagesIn.push_back({_interface.shared_from_this(), m_msgTemporaryIn});
+            m_qMessagesIn.push_back({_interface.shared_from_this(), std::move(m_msgTemporaryIn)});
         } else {
-            m_qMessagesIn.push_back({nullptr, m_msgTemporaryIn});
+            m_qMessagesIn.push_back({nullptr, std::move(m_msgTemporaryIn)});
         }
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::AddToIncomingMessageQueue() {
+        PushToIncomingMessageQueue();
         if constexpr (std::is_same<T, TCPMsg>::value) ReadHeader();
         else if constexpr (std::is_same<T, TCPRawMsg>::value) ReadRaw();
     }
@@ -254,7 +638,8 @@ namespace TCPConn {
     template <typename T>
     void TCPConnImpl<T>::ReadRaw() {
         if constexpr (std::is_same<T, TCPRawMsg>::value) {
-            m_msgTemporaryIn.body.resize(RAW_RECEIVE_BUFFER_SIZE);
+            if (m_bQuickAck) RearmQuickAck(m_socket);
+            m_msgTemporaryIn.body = m_bufferPool.Acquire(RAW_RECEIVE_BUFFER_SIZE);
             m_socket.async_receive(buffer(m_msgTemporaryIn.body.data(), RAW_RECEIVE_BUFFER_SIZE),
                                    [this](std::error_code ec, std::size_t length) {
                                        if (!ec) {
@@ -265,32 +650,12 @@ namespace TCPConn {
                                                INFO_MSG("[Client {:02}] Receive raw message fail, closing connection.", id);
                                            else
                                                INFO_MSG("Receive raw message from server fail, closing connection.");
-                                           m_socket.close();
+                                           CloseSocket();
                                        }
                                    });
         }
     }
 
-    template <typename T>
-    void TCPConnImpl<T>::WriteRaw() {
-        if constexpr (std::is_same<T, TCPRawMsg>::value)
-            async_write(m_socket, buffer(m_qMessagesOut.front().body.data(), m_qMessagesOut.front().full_size()),
-                    [this](std::error_code ec, std::size_t length) {
-                        if (!ec) {
-                            m_qMessagesOut.pop_front();
-                            if (!m_qMessagesOut.empty()) {
-                                WriteRaw();
-                            }
-                        } else {
-                            if (m_eOwnerType == ITCPConn<T>::EOwner::server)
-                                INFO_MSG("[Client {:02}] Write raw message fail, closing connection.", id);
-                            else
-                                INFO_MSG("Write raw message to server fail, closing connection.");
-                            m_socket.close();
-                        }
-                    });
-    }
-
     template <typename T>
     void TCPConnImpl<T>::WriteValidation() {
         if (m_eOwnerType == ITCPConn<T>::EOwner::server)
@@ -298,7 +663,7 @@ namespace TCPConn {
                         [this](std::error_code ec, std::size_t length) {
                             if (ec) {
                                 INFO_MSG("[Client {:02}] Write validation message fail, closing connection.", id);
-                                m_socket.close();
+                                CloseSocket();
                             }
                         });
     }
@@ -310,32 +675,55 @@ namespace TCPConn {
                        [this](std::error_code ec, std::size_t length) {
                            if (!ec) {
                                if (m_nValidationIn == m_nValidationCheck) {
-                                   INFO_MSG("[Client {:02}] New client validated.", id);
-                                   NotifyValidation();
-                                   if constexpr (std::is_same<T, TCPMsg>::value) ReadHeader();
-                                   else if constexpr (std::is_same<T, TCPRawMsg>::value) ReadRaw();
+                                   AcceptValidation();
+                               } else if (m_nValidationIn == CalculateCapsValidation(m_nValidationOut)) {
+                                   // The client answered the marked challenge, its caps word follows
+                                   m_bPeerCaps = true;
+                                   m_nValidationCheck = m_nValidationIn;
+                                   async_read(m_socket, buffer(&m_nCapsIn, sizeof(uint64_t)),
+                                              [this](std::error_code ec, std::size_t length) {
+                                                  if (!ec) {
+                                                      AcceptValidation();
+                                                  } else {
+                                                      INFO_MSG("[Client {:02}] Read validation message fail, closing connection.", id);
+                                                      CloseSocket();
+                                                  }
+                                              });
                                } else {
                                    INFO_MSG("[Client {:02}] Client validation message fail, refusing connection.", id);
-                                   m_socket.close();
+                                   CloseSocket();
                                }
                            } else {
                                INFO_MSG("[Client {:02}] Read validation message fail, closing connection.", id);
-                               m_socket.close();
+                               CloseSocket();
                            }
                        });
     }
 
+    template <typename T>
+    void TCPConnImpl<T>::AcceptValidation() {
+        m_stats.HandshakeDone();
+        NegotiateCaps();
+        INFO_MSG("[Client {:02}] New client validated.", id);
+        NotifyValidation();
+        if (m_bShm) WatchShmPeer();
+        else if constexpr (std::is_same<T, TCPMsg>::value) ReadHeader();
+        else if constexpr (std::is_same<T, TCPRawMsg>::value) ReadRaw();
+    }
+
     template<typename T>
     void TCPConnImpl<T>::ReadValidation(const std::function<void()> &OnConnectedCallback) {
         if (m_eOwnerType == ITCPConn<T>::EOwner::client)
             async_read(m_socket, buffer(&m_nValidationIn, sizeof(uint64_t)),
                        [this, OnConnectedCallback](std::error_code ec, std::size_t length) {
                            if (!ec) {
-                               m_nValidationOut = CalculateValidation(m_nValidationIn);
+                               m_bPeerCaps = HasCapsMark(m_nValidationIn);
+                               m_nValidationOut = m_bPeerCaps ? CalculateCapsValidation(m_nValidationIn)
+                                                              : CalculateValidation(m_nValidationIn);
                                WriteValidation(OnConnectedCallback);
                            } else {
                                INFO_MSG("Read validation message from server fail, closing connection.");
-                               m_socket.close();
+                               CloseSocket();
                            }
                        });
     }
@@ -343,13 +731,13 @@ namespace TCPConn {
     template <typename T>
     void TCPConnImpl<T>::WriteValidation(const std::function<void()>& OnConnectedCallback) {
         if (m_eOwnerType == ITCPConn<T>::EOwner::client)
-            async_write(m_socket, buffer(&m_nValidationOut, sizeof(uint64_t)),
+            async_write(m_socket, std::array{buffer(&m_nValidationOut, sizeof(uint64_t)), buffer(&m_nCapsOut, m_bPeerCaps ? sizeof(uint64_t) : 0)},
                         [this, OnConnectedCallback](std::error_code ec, std::size_t length) {
                             if (!ec) {
                                 WaitForValidation(OnConnectedCallback);
                             } else {
                                 INFO_MSG("Write validation message fail, closing connection.");
-                                m_socket.close();
+                                CloseSocket();
                             }
                         });
     }
@@ -357,13 +745,14 @@ namespace TCPConn {
     template<typename T>
     void TCPConnImpl<T>::NotifyValidation() {
         if (m_eOwnerType == ITCPConn<T>::EOwner::server) {
-            async_write(m_socket, buffer(&m_nValidationCheck, sizeof(uint64_t)),
+            async_write(m_socket, std::array{buffer(&m_nValidationCheck, sizeof(uint64_t)), buffer(&m_nCapsOut, m_bPeerCaps ? sizeof(uint64_t) : 0)},
                         [this](std::error_code ec, std::size_t length) {
                             if (!ec) {
                                 INFO_MSG("[Client {:02}] Validation notification sent to client.", id);
+                                if (m_bShm) OpenShm();
                             } else {
                                 INFO_MSG("[Client {:02}] Notify validation fail, closing connection.", id);
-                                m_socket.close();
+                                CloseSocket();
                             }
                         });
         }
@@ -372,29 +761,323 @@ namespace TCPConn {
     template<typename T>
     void TCPConnImpl<T>::WaitForValidation(const std::function<void()>& OnConnectedCallback) {
         if (m_eOwnerType == ITCPConn<T>::EOwner::client) {
-            async_read(m_socket, buffer(&m_nValidationCheck, sizeof(uint64_t)),
+            async_read(m_socket, std::array{buffer(&m_nValidationCheck, sizeof(uint64_t)), buffer(&m_nCapsIn, m_bPeerCaps ? sizeof(uint64_t) : 0)},
                         [this, OnConnectedCallback](std::error_code ec, std::size_t length) {
                             if (!ec) {
                                 if (m_nValidationCheck == m_nValidationOut) {
+                                    m_stats.HandshakeDone();
+                                    NegotiateCaps();
                                     INFO_MSG("Validation notification received from server.");
+                                    if (m_bShm) {
+                                        ReceiveShm(OnConnectedCallback);
+                                        return;
+                                    }
                                     auto async_call = std::async(std::launch::async, OnConnectedCallback);
                                     if constexpr (std::is_same<T, TCPMsg>::value) ReadHeader();
                                     else if constexpr (std::is_same<T, TCPRawMsg>::value) ReadRaw();
+                                    NotifyConnectResult(true);
+                                } else {
+                                    INFO_MSG("Validation notification from server mismatched, closing connection.");
+                                    CloseSocket();
                                 }
                             } else {
                                 INFO_MSG("Receive validation notification fail, closing connection.");
-                                m_socket.close();
+                                CloseSocket();
                             }
                         });
         }
     }
     
+    template <typename T>
+    void TCPConnImpl<T>::NotifyConnectResult(bool bConnected) {
+        if (auto fn = std::exchange(m_fnConnectResult, nullptr)) fn(bConnected);
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::CloseSocket(std::error_code ec) {
+        m_socket.close();
+        if (m_bShm) {
+            std::scoped_lock lock(m_mtxShm);
+            if (m_pShm) m_pShm->Close();
+        }
+        FailAwaiters(ec);
+        if (auto fnClose = std::exchange(m_fnClose, nullptr)) fnClose();
+    }
+
+    template <typename T>
+    std::future<void> TCPConnImpl<T>::CloseOnIoThread(std::error_code ec) {
+        auto pDone = std::make_shared<std::promise<void>>();
+        auto future = pDone->get_future();
+        if (m_context.stopped()) {
+            CloseSocket(ec);
+            pDone->set_value();
+        } else {
+            // Runs in place when already on the io thread of this connection
+            dispatch(m_socket.get_executor(), [this, ec, pDone]() {
+                CloseSocket(ec);
+                pDone->set_value();
+            });
+        }
+        return future;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::FailAwaiters(std::error_code ec) {
+        NotifyConnectResult(false);
+        if (auto pWaiter = std::exchange(m_pReceiveWaiter, nullptr)) pWaiter->Fail(ec);
+        auto qWriteWaiters = std::move(m_qWriteWaiters);
+        m_qWriteWaiters.clear();
+        for (auto& [pMsg, pWaiter] : qWriteWaiters) pWaiter->Fail(ec);
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::NegotiateCaps() {
+        // Each side compresses what it sends on its own level, as long as the other side can inflate
+        // Shared memory is taken when both sides offered it, bodies then stay uncompressed
+        m_bShm = (m_nCapsOut & m_nCapsIn & TCPCAP_SHARED_MEMORY) != 0;
+        // From here on every queued message is counted, direct ring writes wait for all of them
+        if (m_bShm) CountShm(m_qMessagesOut.size());
+        m_bCompress = TCPCONN_COMPRESSION_ENABLED && m_config.compression_level > 0 && (m_nCapsIn & TCPCAP_DEFLATE) &&
+                      !m_bShm;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::OpenShm() {
+#ifdef TCPCONN_HAS_SHM
+        auto pChannel = TCPShmChannel::Create(m_socket.get_executor(), m_config.shm_ring_bytes);
+        if (!pChannel || !pChannel->SendTo(m_socket.native_handle())) {
+            ERROR_MSG("[Client {:02}] Cannot hand shared memory to client, closing connection.", id);
+            CloseSocket();
+            return;
+        }
+        pChannel->ReleaseMemFd();
+        INFO_MSG("[Client {:02}] Shared memory handed to client.", id);
+        StartShm(std::move(pChannel));
+#endif
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::ReceiveShm(const std::function<void()>& OnConnectedCallback) {
+#ifdef TCPCONN_HAS_SHM
+        m_socket.async_wait(socket_base::wait_read, [this, OnConnectedCallback](std::error_code ec) {
+            std::unique_ptr<TCPShmChannel> pChannel;
+            if (!ec) pChannel = TCPShmChannel::ReceiveFrom(m_socket.get_executor(), m_socket.native_handle(), ec);
+            if (ec == std::errc::operation_would_block || ec == std::errc::resource_unavailable_try_again) {
+                ReceiveShm(OnConnectedCallback);
+                return;
+            }
+            if (!pChannel) {
+                INFO_MSG("Receive shared memory from server fail, closing connection.");
+                CloseSocket();
+                return;
+            }
+            INFO_MSG("Shared memory received from server.");
+            StartShm(std::move(pChannel));
+            auto async_call = std::async(std::launch::async, OnConnectedCallback);
+            WatchShmPeer();
+            NotifyConnectResult(true);
+        });
+#endif
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::StartShm(std::unique_ptr<TCPShmChannel> pChannel) {
+        {
+            std::scoped_lock lock(m_mtxShm);
+            m_pShm = std::move(pChannel);
+        }
+        ReadShm();
+        if (!m_qMessagesOut.empty()) WriteShm();
+    }
+
+    template <typename T>
+    bool TCPConnImpl<T>::TrySendShm(const T& msg) {
+#ifdef TCPCONN_HAS_SHM
+        std::scoped_lock lock(m_mtxShm);
+        if (m_pShm && m_pShm->IsOpen() && m_nShmQueued == 0 && m_pShm->Tx().Writable() >= msg.full_size()) {
+            auto tStart = TCPConnStatsRecorder::Now();
+            WriteShmFrame(m_pShm->Tx(), msg, 0);
+            m_pShm->Tx().Publish();
+            m_stats.Written(1, msg.full_size(), tStart);
+            return true;
+        }
+        m_nShmQueued++;
+#endif
+        return false;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::CountShm(size_t nMessages) {
+        std::scoped_lock lock(m_mtxShm);
+        m_nShmQueued += nMessages;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::UnqueueShm(size_t nMessages) {
+        std::scoped_lock lock(m_mtxShm);
+        m_nShmQueued -= nMessages;
+    }
+
+    template <typename T>
+    size_t TCPConnImpl<T>::WriteShmFrame(TCPShmRing& ring, const T& msg, size_t nOffset) {
+#ifdef TCPCONN_HAS_SHM
+        if constexpr (std::is_same<T, TCPMsg>::value) {
+            if (nOffset < sizeof(TCPMsgHeader))
+                nOffset += ring.Write(reinterpret_cast<const uint8_t*>(&msg.header) + nOffset,
+                                      sizeof(TCPMsgHeader) - nOffset);
+            if (nOffset >= sizeof(TCPMsgHeader)) {
+                size_t nWritten = nOffset - sizeof(TCPMsgHeader);
+                nOffset += ring.Write(msg.body.data() + nWritten, msg.body.size() - nWritten);
+            }
+        }
+#endif
+        return nOffset;
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::WriteShm() {
+#ifdef TCPCONN_HAS_SHM
+        if constexpr (std::is_same<T, TCPMsg>::value) {
+            std::vector<std::shared_ptr<TCPAsyncState<void>>> vecWritten;
+            size_t nMessages = 0;
+            size_t nBytes = 0;
+            bool bWait = false;
+            {
+                std::scoped_lock lock(m_mtxShm);
+                if (!m_pShm || !m_pShm->IsOpen()) return;
+                TCPShmRing& ring = m_pShm->Tx();
+                auto tStart = TCPConnStatsRecorder::Now();
+                // Frames larger than the free room are written in pieces as the reader makes room
+                while (!m_qMessagesOut.empty()) {
+                    const T* pMsg = m_qMessagesOut.front().get();
+                    m_nShmWriteOffset = WriteShmFrame(ring, *pMsg, m_nShmWriteOffset);
+                    if (m_nShmWriteOffset < pMsg->full_size()) break;
+                    m_nShmWriteOffset = 0;
+                    if (!m_qWriteWaiters.empty() && m_qWriteWaiters.front().first == pMsg) {
+                        vecWritten.push_back(std::move(m_qWriteWaiters.front().second));
+                        m_qWriteWaiters.pop_front();
+                    }
+                    nMessages++;
+                    nBytes += pMsg->full_size();
+                    m_qMessagesOut.pop_front();
+                    m_nShmQueued--;
+                }
+                ring.Publish();
+                if (nMessages > 0) m_stats.Written(nMessages, nBytes, tStart);
+                // A partly written frame must stay in front, see TrimOutgoingMessages()
+                m_nMessagesWriting = m_nShmWriteOffset > 0 ? 1 : 0;
+                bWait = !m_qMessagesOut.empty() && ring.PrepareWriteWait();
+            }
+            if (nMessages > 0) {
+                m_stats.OutgoingDepth(m_qMessagesOut.size());
+                m_limiter.Release(nMessages, nBytes);
+                NotifyWatermarks();
+            }
+            if (bWait) {
+                m_pShm->SpaceEvent().async_read_some(buffer(&m_nShmSpaceEvent, sizeof(uint64_t)),
+                                                     [this](std::error_code ec, std::size_t length) {
+                                                         if (!ec) WriteShm();
+                                                     });
+            } else if (!m_qMessagesOut.empty()) {
+                post(m_socket.get_executor(), [this]() { WriteShm(); });
+            }
+            for (auto& pWaiter : vecWritten) pWaiter->Complete();
+        }
+#endif
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::ReadShm() {
+#ifdef TCPCONN_HAS_SHM
+        if constexpr (std::is_same<T, TCPMsg>::value) {
+            TCPShmRing& ring = m_pShm->Rx();
+            auto* pHeader = reinterpret_cast<uint8_t*>(&m_msgTemporaryIn.header);
+            auto tSpin = std::chrono::microseconds(m_config.shm_spin_us);
+            auto tSpinUntil = std::chrono::steady_clock::now() + tSpin;
+            for (size_t nMessages = 0; m_pShm->IsOpen();) {
+                // Frames larger than the ring arrive in pieces, the offset carries over to the next call
+                if (m_nShmReadOffset < sizeof(TCPMsgHeader)) {
+                    m_nShmReadOffset += ring.Read(pHeader + m_nShmReadOffset, sizeof(TCPMsgHeader) - m_nShmReadOffset);
+                    if (m_nShmReadOffset == sizeof(TCPMsgHeader)) {
+                        if (size_t nBody = BodySize(m_msgTemporaryIn.header); nBody > 0)
+                            m_msgTemporaryIn.body = m_bufferPool.Acquire(nBody);
+                        else
+                            m_msgTemporaryIn.body.clear();
+                    }
+                }
+                if (m_nShmReadOffset >= sizeof(TCPMsgHeader)) {
+                    auto& body = m_msgTemporaryIn.body;
+                    size_t nRead = m_nShmReadOffset - sizeof(TCPMsgHeader);
+                    m_nShmReadOffset += ring.Read(body.data() + nRead, body.size() - nRead);
+                    if (m_nShmReadOffset == sizeof(TCPMsgHeader) + body.size()) {
+                        m_nShmReadOffset = 0;
+                        ring.Consume();
+                        PushToIncomingMessageQueue();
+                        // Give other connections on this io thread a turn
+                        if (++nMessages == SHM_READ_BATCH) {
+                            post(m_socket.get_executor(), [this]() { ReadShm(); });
+                            return;
+                        }
+                        tSpinUntil = std::chrono::steady_clock::now() + tSpin;
+                        continue;
+                    }
+                }
+                ring.Consume();
+                if (ring.Readable() > 0) continue;
+                // Poll a while before sleeping, the next frame often follows closely
+                if (std::chrono::steady_clock::now() < tSpinUntil) {
+                    CpuRelax();
+                    continue;
+                }
+                if (!ring.PrepareReadWait()) continue;
+                m_pShm->DataEvent().async_read_some(buffer(&m_nShmDataEvent, sizeof(uint64_t)),
+                                                    [this](std::error_code ec, std::size_t length) {
+                                                        if (!ec) ReadShm();
+                                                    });
+                return;
+            }
+        }
+#endif
+    }
+
+    template <typename T>
+    void TCPConnImpl<T>::WatchShmPeer() {
+        // Nothing is sent over the socket anymore, it completes once the peer closes
+        m_socket.async_read_some(buffer(&m_nShmPeerByte, 1), [this](std::error_code ec, std::size_t length) {
+            if (m_eOwnerType == ITCPConn<T>::EOwner::server)
+                INFO_MSG("[Client {:02}] Shared memory peer closed, closing connection.", id);
+            else
+                INFO_MSG("Shared memory server closed, closing connection.");
+            CloseSocket();
+        });
+    }
+
     template <typename T>
     uint64_t TCPConnImpl<T>::CalculateValidation(uint64_t nInput) {
         return nInput ^ 0x4B554C657576656E;
     }
 
+    template <typename T>
+    uint64_t TCPConnImpl<T>::CalculateCapsValidation(uint64_t nInput) {
+        return nInput ^ 0x4341505356616C31;
+    }
+
+    template <typename T>
+    uint64_t TCPConnImpl<T>::MarkCapsChallenge(uint64_t nChallenge) {
+        // Low half derived from the high half, a plain timestamp matches by chance once in 2^32 handshakes
+        uint64_t nHigh = nChallenge >> 32;
+        return (nHigh << 32) | (uint32_t(nHigh * 0x9E3779B1u) ^ 0x54435043u);
+    }
+
+    template <typename T>
+    bool TCPConnImpl<T>::HasCapsMark(uint64_t nChallenge) {
+        return MarkCapsChallenge(nChallenge) == nChallenge;
+    }
+
     template class ITCPConn<TCPMsg>;
     template class ITCPConn<TCPRawMsg>;
+    // The server and client reach into the connection for coroutine support
+    template class TCPConnImpl<TCPMsg>;
+    template class TCPConnImpl<TCPRawMsg>;
 
 } // TCPConn
\ No newline at end of file
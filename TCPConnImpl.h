@@ -6,7 +6,17 @@
 #define TCPCONN_TCPCONNIMPL_H
 
 #include "TCPConn.h"
+#include "TCPBufferPool.h"
+#include "TCPStatsRecorder.h"
+#include "TCPOutgoingLimiter.h"
+#include "TCPCompression.h"
+#include "TCPSocketTuning.h"
+#include "TCPIoEngine.h"
+#include "TCPTransport.h"
+#include "TCPSharedMemory.h"
+#include "TCPCapture.h"
 #include <boost/asio.hpp>
+#include <future>
 
 using namespace boost::asio;
 
@@ -15,26 +25,33 @@ namespace TCPConn {
     template <typename T>
     struct ITCPConn<T>::TCPContext {
         io_context &context;
-        ip::tcp::socket socket;
+        TCPStreamSocket socket;
+        TCPBufferPool &pool;
+        std::shared_ptr<TCPReadBufferSlab> slab{};  // registered receive buffers, null unless on io_uring
+        bool shared_memory = false;                 // offer shared memory rings during validation, on `shm:` addresses
     };
 
     template <typename T>
     struct ITCPConn<T>::TCPEndpoint {
-        ip::tcp::resolver::results_type &endpoint;
+        std::vector<TCPStreamEndpoint> &endpoint;     // TCP addresses to try in order, or one Unix domain socket
     };
 
     template <typename T>
     class TCPConnImpl {
     public:
         TCPConnImpl(ITCPConn<T>& interface, ITCPConn<T>::EOwner owner, 
-                    struct ITCPConn<T>::TCPContext& context, TCPMsgQueue<TCPMsgOwned<T>>& qIn);
+                    struct ITCPConn<T>::TCPContext& context, TCPMsgQueue<TCPMsgOwned<T>>& qIn,
+                    const TCPConnConfig& config);
         virtual ~TCPConnImpl();
 
-        [[nodiscard]] uint32_t GetID() const;
+        [[nodiscard]] uint64_t GetID() const;
         std::string GetRemoteEndpoint() const;
+        [[nodiscard]] TCPConnStats GetStats() const;
+        [[nodiscard]] TCPSocketOptions GetSocketOptions() const;
 
-        void ConnectToClient(uint32_t uid = 0);
-        void ConnectToServer(const struct ITCPConn<T>::TCPEndpoint &endpoint, const std::function<void()>& OnConnectedCallback);
+        void ConnectToClient(uint64_t uid = 0);
+        void ConnectToServer(const struct ITCPConn<T>::TCPEndpoint &endpoint, const std::function<void()>& OnConnectedCallback,
+                             const std::function<void(bool)>& OnResultCallback);
         void Disconnect();
         [[nodiscard]] bool IsConnected() const;
 
@@ -46,34 +63,124 @@ namespace TCPConn {
         void ReadValidation(const std::function<void()>& OnConnectedCallback);
         void WriteValidation(const std::function<void()>& OnConnectedCallback);
         void WaitForValidation(const std::function<void()>& OnConnectedCallback);
+        void AcceptValidation();
         static uint64_t CalculateValidation(uint64_t nInput);
+        // Peers exchanging caps words mark their challenge and answer marked ones with another key,
+        // peers predating caps keep the plain 8-byte handshake
+        static uint64_t CalculateCapsValidation(uint64_t nInput);
+        static uint64_t MarkCapsChallenge(uint64_t nChallenge);
+        static bool HasCapsMark(uint64_t nChallenge);
         
         void Send(const T& msg);
+        void Send(T&& msg);
+        // pDeflated carries the compressed body of a broadcast payload across the connections it is sent to
+        void Send(const TCPMsgShared<T>& msg, std::shared_ptr<TCPAsyncState<void>> pWaiter = nullptr,
+                  TCPDeflatedShare* pDeflated = nullptr);
+        TCPAsync<void> SendAsync(T&& msg);
+        TCPAsync<T> Receive();
+        // Deliver messages to Receive() from the start, called before the connection starts reading
+        void EnableReceive() { m_bReceiveDirect = true; }
+        void FailAwaiters(std::error_code ec);
+        // Close on the io thread of this connection before the io threads stop, so awaiting coroutines resume
+        // there and any await that follows fails at once; ready when done
+        std::future<void> CloseOnIoThread(std::error_code ec);
+        void SetOverflowPolicy(EOverflowPolicy policy);
+        void SetWatermarkCallback(const std::function<void(bool)>& callback);
+        void SetMessageInterceptor(const std::function<bool(T&)>& callback);
+        void SetCloseCallback(const std::function<void()>& callback);
 
     protected:
 
         void ReadHeader();
         void ReadBody();
-        void WriteHeader();
-        void WriteBody();
+        void ReadBuffered();
+        void WriteMessages();
+        void TrimOutgoingMessages();
+        void NotifyWatermarks();
         void AddToIncomingMessageQueue();
+        void PushToIncomingMessageQueue();
+        void NotifyConnectResult(bool bConnected);
+        void CloseSocket(std::error_code ec = std::make_error_code(std::errc::connection_aborted));
         
         void ReadRaw();
-        void WriteRaw();
+        void NegotiateCaps();
+        static size_t BodySize(const TCPMsgHeader& header);
+        // Connection ID in capture records, 0 on clients
+        uint64_t CaptureID() const { return m_eOwnerType == ITCPConn<T>::EOwner::server ? id : 0; }
         
-        ip::tcp::socket m_socket;
+        // Shared memory transport: the server creates the channel once validated and the client attaches to it,
+        // the socket then only reports the peer closing
+        void OpenShm();
+        void ReceiveShm(const std::function<void()>& OnConnectedCallback);
+        void StartShm(std::unique_ptr<TCPShmChannel> pChannel);
+        bool TrySendShm(const T& msg);
+        void CountShm(size_t nMessages);
+        void UnqueueShm(size_t nMessages = 1);
+        void ReadShm();
+        void WriteShm();
+        void WatchShmPeer();
+        static size_t WriteShmFrame(TCPShmRing& ring, const T& msg, size_t nOffset);
+        
+        TCPStreamSocket m_socket;
         io_context& m_context;
+        TCPConnConfig m_config;
         
-        TCPMsgQueue<T> m_qMessagesOut{};
+        // Only touched on the io thread, no locking needed
+        std::deque<TCPMsgShared<T>> m_qMessagesOut{};
+        std::vector<const_buffer> m_vecWriteBuffers;
+        size_t m_nMessagesWriting = 0;
+        TCPOutgoingLimiter m_limiter;
+        bool m_bQuickAck = false;  // re-arm TCP_QUICKACK before every read
+        std::function<void(bool)> m_fnWatermark;
+        std::function<bool(T&)> m_fnIntercept;
+        std::function<void()> m_fnClose;  // reset once called
         TCPMsgQueue<TCPMsgOwned<T>>& m_qMessagesIn;
+        TCPBufferPool& m_bufferPool;
         T m_msgTemporaryIn;
         
+        // Receive buffer of EReadMode::buffered, bytes [m_nReadBegin, m_nReadEnd) are pending.
+        // Points into a slot of the slab when one was free, otherwise into m_vecReadBuffer.
+        std::shared_ptr<TCPReadBufferSlab> m_pReadSlab;
+        int m_nReadSlot = -1;
+        std::vector<uint8_t> m_vecReadBuffer;
+        uint8_t* m_pReadBuffer = nullptr;
+        size_t m_nReadBufferSize = 0;
+        size_t m_nReadBegin = 0;
+        size_t m_nReadEnd = 0;
+        
+        // Awaited operations, only touched on the io thread
+        bool m_bReceiveDirect = false;  // messages go to Receive() rather than the incoming queue
+        std::deque<T> m_qReceived;
+        std::shared_ptr<TCPAsyncState<T>> m_pReceiveWaiter;
+        std::deque<std::pair<const T*, std::shared_ptr<TCPAsyncState<void>>>> m_qWriteWaiters;  // in queue order
+        std::function<void(bool)> m_fnConnectResult;
+        
+        // Written from the handlers of this connection; shm sends record Written() under m_mtxShm, so one writer at a time
+        TCPConnStatsRecorder m_stats;
+        TCPConnStatsRecorder::Clock::time_point m_tWriteStart{};
+        
         uint64_t m_nValidationOut = 0;
         uint64_t m_nValidationIn = 0;
         uint64_t m_nValidationCheck = 0;
+        // Capabilities sent after the validation words, see ETCPCaps
+        uint64_t m_nCapsOut = TCPCONN_LOCAL_CAPS;
+        uint64_t m_nCapsIn = 0;
+        bool m_bPeerCaps = false;
+        std::atomic<bool> m_bCompress{false};
+        std::atomic<bool> m_bShm{false};
+        
+        // Any sending thread writes to the Tx() ring of the channel, under m_mtxShm
+        std::unique_ptr<TCPShmChannel> m_pShm;
+        std::mutex m_mtxShm;
+        size_t m_nShmQueued = 0;        // sends posted to or waiting in m_qMessagesOut, later sends must not overtake them
+        size_t m_nShmWriteOffset = 0;   // bytes of the front outgoing frame already in the ring
+        size_t m_nShmReadOffset = 0;    // bytes of m_msgTemporaryIn already read from the ring
+        uint64_t m_nShmDataEvent = 0;
+        uint64_t m_nShmSpaceEvent = 0;
+        uint8_t m_nShmPeerByte = 0;
         
         ITCPConn<T>::EOwner m_eOwnerType;
-        uint32_t id = -1;
+        uint64_t id = -1;
         
     private:
         ITCPConn<T>& _interface;
@@ -0,0 +1,124 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPCONNREGISTRY_H
+#define TCPCONN_TCPCONNREGISTRY_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace TCPConn {
+
+    /// \brief Slab of connections addressed by generational 64-bit IDs.
+    /// An ID holds the slot index in its low 32 bits and the generation of the slot in its high 32 bits,
+    /// a slot bumps its generation on every removal so a stale ID never matches a later connection.
+    /// Insert, lookup and removal are O(1), connections are iterated from a packed array.
+    /// Not thread-safe, the server guards it with its connection mutex.
+    template <typename TConn>
+    class TCPConnRegistry {
+    public:
+        using Entry = std::shared_ptr<TConn>;
+
+        /// \brief Add a connection.
+        /// \return ID of the connection, never 0
+        uint64_t Insert(Entry conn) {
+            uint32_t nSlot;
+            if (!m_vecFreeSlots.empty()) {
+                nSlot = m_vecFreeSlots.back();
+                m_vecFreeSlots.pop_back();
+            } else {
+                nSlot = uint32_t(m_vecSlots.size());
+                m_vecSlots.push_back({});
+            }
+            Slot& slot = m_vecSlots[nSlot];
+            slot.nDense = uint32_t(m_vecDense.size());
+            m_vecDense.push_back(std::move(conn));
+            m_vecDenseSlots.push_back(nSlot);
+            return MakeID(nSlot, slot.nGeneration);
+        }
+
+        /// \brief Find a connection.
+        /// \return the connection, or nullptr if the ID is unknown or was removed
+        [[nodiscard]] Entry Find(uint64_t nID) const {
+            const Slot* pSlot = Lookup(nID);
+            return pSlot ? m_vecDense[pSlot->nDense] : nullptr;
+        }
+
+        /// \brief Remove a connection, the last one in the packed array takes its place.
+        /// \return false if the ID is unknown or was already removed
+        bool Remove(uint64_t nID) {
+            Slot* pSlot = Lookup(nID);
+            if (!pSlot) return false;
+            RemoveDense(pSlot->nDense);
+            return true;
+        }
+
+        /// \brief Remove every connection matching a predicate in one pass.
+        /// \param pred called with each connection, returns true to remove it
+        template <typename F>
+        void EraseIf(F&& pred) {
+            for (size_t i = 0; i < m_vecDense.size();) {
+                if (pred(m_vecDense[i])) RemoveDense(uint32_t(i));
+                else i++;
+            }
+        }
+
+        [[nodiscard]] size_t size() const { return m_vecDense.size(); }
+        [[nodiscard]] bool empty() const { return m_vecDense.empty(); }
+
+        auto begin() { return m_vecDense.begin(); }
+        auto end() { return m_vecDense.end(); }
+        auto begin() const { return m_vecDense.begin(); }
+        auto end() const { return m_vecDense.end(); }
+
+    protected:
+        static constexpr uint32_t INVALID = uint32_t(-1);
+
+        struct Slot {
+            uint32_t nGeneration = 1;
+            uint32_t nDense = INVALID;
+        };
+
+        static uint64_t MakeID(uint32_t nSlot, uint32_t nGeneration) {
+            return (uint64_t(nGeneration) << 32) | nSlot;
+        }
+
+        void RemoveDense(uint32_t nDense) {
+            uint32_t nSlot = m_vecDenseSlots[nDense];
+            auto nLast = uint32_t(m_vecDense.size() - 1);
+            if (nDense != nLast) {
+                m_vecDense[nDense] = std::move(m_vecDense[nLast]);
+                m_vecDenseSlots[nDense] = m_vecDenseSlots[nLast];
+                m_vecSlots[m_vecDenseSlots[nDense]].nDense = nDense;
+            }
+            m_vecDense.pop_back();
+            m_vecDenseSlots.pop_back();
+            Slot& slot = m_vecSlots[nSlot];
+            slot.nDense = INVALID;
+            if (++slot.nGeneration == 0) slot.nGeneration = 1;
+            m_vecFreeSlots.push_back(nSlot);
+        }
+
+        Slot* Lookup(uint64_t nID) {
+            auto nSlot = uint32_t(nID);
+            if (nSlot >= m_vecSlots.size()) return nullptr;
+            Slot& slot = m_vecSlots[nSlot];
+            if (slot.nDense == INVALID || slot.nGeneration != uint32_t(nID >> 32)) return nullptr;
+            return &slot;
+        }
+
+        const Slot* Lookup(uint64_t nID) const {
+            return const_cast<TCPConnRegistry*>(this)->Lookup(nID);
+        }
+
+        std::vector<Slot> m_vecSlots;
+        std::vector<uint32_t> m_vecFreeSlots;
+        std::vector<Entry> m_vecDense;          // connections, packed for iteration
+        std::vector<uint32_t> m_vecDenseSlots;  // slot of each packed connection
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPCONNREGISTRY_H
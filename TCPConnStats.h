@@ -0,0 +1,98 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPCONNSTATS_H
+#define TCPCONN_TCPCONNSTATS_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace TCPConn {
+
+    /// \brief Latency distribution over fixed power-of-two buckets.
+    /// Bucket 0 counts samples of 0 ns, bucket i counts samples in [2^(i-1), 2^i) ns,
+    /// the last bucket also takes everything above.
+    struct TCPLatencyHistogram {
+        static constexpr size_t NUM_BUCKETS = 40;   // 2^39 ns, about 9 minutes
+
+        std::array<uint64_t, NUM_BUCKETS> buckets{};
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t max_ns = 0;
+
+        [[nodiscard]] double mean_ns() const {
+            return count ? double(sum_ns) / double(count) : 0;
+        }
+
+        /// \brief Upper bound of the bucket holding the given rank.
+        /// \param dRank rank between 0 and 1, e.g. 0.99 for p99
+        /// \return latency in ns, never above the largest sample
+        [[nodiscard]] uint64_t percentile_ns(double dRank) const {
+            if (count == 0) return 0;
+            auto nTarget = std::max<uint64_t>(1, uint64_t(dRank * double(count) + 0.5));
+            uint64_t nSeen = 0;
+            for (size_t i = 0; i < NUM_BUCKETS; i++) {
+                nSeen += buckets[i];
+                if (nSeen >= nTarget) return i == 0 ? 0 : std::min(uint64_t(1) << i, max_ns);
+            }
+            return max_ns;
+        }
+
+        TCPLatencyHistogram& operator += (const TCPLatencyHistogram& other) {
+            for (size_t i = 0; i < NUM_BUCKETS; i++) buckets[i] += other.buckets[i];
+            count += other.count;
+            sum_ns += other.sum_ns;
+            max_ns = std::max(max_ns, other.max_ns);
+            return *this;
+        }
+    };
+
+    /// \brief Snapshot of the runtime metrics of one connection.
+    /// All values are zero when the library is built with `TCPCONN_NO_STATS`.
+    struct TCPConnStats {
+        uint64_t bytes_in = 0;              ///< received bytes, `TCPMsg` headers included
+        uint64_t bytes_out = 0;             ///< written bytes, `TCPMsg` headers included
+        uint64_t messages_in = 0;           ///< messages pushed to the incoming queue
+        uint64_t messages_out = 0;          ///< messages completely written to the socket
+        uint64_t messages_dropped = 0;      ///< messages discarded by the overflow policy
+        size_t outgoing_queue_depth = 0;    ///< messages waiting in or being written from the outgoing queue
+        size_t incoming_queue_depth = 0;    ///< messages waiting in the incoming queue of the owner, shared by its connections
+        uint64_t handshake_ns = 0;          ///< time from connecting until the connection carries messages
+        TCPLatencyHistogram write_latency;  ///< time from starting a gathered write until its completion
+        bool compression_negotiated = false;    ///< the peer can inflate bodies and compression is enabled
+        uint64_t compressed_bodies = 0;         ///< outgoing bodies sent compressed
+        uint64_t compressed_bytes_before = 0;   ///< size of those bodies before compression
+        uint64_t compressed_bytes_after = 0;    ///< size of those bodies on the wire
+
+        /// \brief Ratio of original to compressed size of the bodies sent compressed, 1 if none.
+        [[nodiscard]] double compression_ratio() const {
+            return compressed_bytes_after ? double(compressed_bytes_before) / double(compressed_bytes_after) : 1;
+        }
+    };
+
+    /// \brief Snapshot of the runtime metrics of a server, summed over its connections.
+    /// Connections dropped by the server keep contributing their totals.
+    struct TCPServerStats {
+        uint64_t connections_accepted = 0;
+        uint64_t connections_denied = 0;
+        size_t connections_active = 0;
+        uint64_t messages_dispatched = 0;   ///< messages handed to `OnMessage`
+        uint64_t bytes_in = 0;
+        uint64_t bytes_out = 0;
+        uint64_t messages_in = 0;
+        uint64_t messages_out = 0;
+        uint64_t messages_dropped = 0;
+        uint64_t compressed_bytes_before = 0;
+        uint64_t compressed_bytes_after = 0;
+        size_t outgoing_queue_depth = 0;    ///< summed over the active connections
+        size_t incoming_queue_depth = 0;
+        TCPLatencyHistogram handshake_latency;
+        TCPLatencyHistogram write_latency;
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPCONNSTATS_H
@@ -0,0 +1,223 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPDISPATCHPOOL_H
+#define TCPCONN_TCPDISPATCHPOOL_H
+
+#include "TCPMsg.h"
+#include "LogMacros.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace TCPConn {
+
+    /// \brief Runs message handlers on worker threads while keeping the order within each connection.
+    /// Messages are collected in a mailbox per connection. A mailbox with pending messages is queued on the
+    /// worker its connection ID maps to, and only one worker drains it at a time. Idle workers steal queued
+    /// mailboxes from the others, so a busy connection never holds up the connections sharing its worker.
+    template <typename T>
+    class TCPDispatchPool {
+    public:
+        /// \brief Receives the drained messages of one connection, in arrival order.
+        using Handler = std::function<void(std::vector<TCPMsgOwned<T>>& msgs)>;
+
+        TCPDispatchPool(size_t nThreads, Handler handler) : m_handler(std::move(handler)), m_workers(nThreads) {
+            for (size_t i = 0; i < nThreads; i++)
+                m_workers[i].thread = std::thread([this, i]() { Work(i); });
+        }
+        TCPDispatchPool(const TCPDispatchPool&) = delete;
+
+        ~TCPDispatchPool() { Stop(); }
+
+        /// \brief Hand messages over to the workers, called by the consumer of the incoming queue.
+        /// \param msgs messages to dispatch, left empty
+        void Post(std::vector<TCPMsgOwned<T>>& msgs) {
+            std::scoped_lock lock(m_mtxMailboxes);
+            for (auto& msg : msgs) {
+                auto& pMailbox = m_mapMailboxes[msg.remote.get()];
+                if (!pMailbox) {
+                    pMailbox = std::make_shared<Mailbox>();
+                    pMailbox->pKey = msg.remote.get();
+                    pMailbox->remote = msg.remote;
+                    pMailbox->nShard = msg.remote ? size_t(msg.remote->GetID() % m_workers.size()) : 0;
+                }
+                bool bSchedule;
+                {
+                    std::scoped_lock lockMailbox(pMailbox->mutex);
+                    pMailbox->pending.push_back(std::move(msg));
+                    bSchedule = !std::exchange(pMailbox->bScheduled, true);
+                }
+                if (bSchedule) Schedule(pMailbox, pMailbox->nShard);
+            }
+            msgs.clear();
+        }
+
+        /// \brief Drop the mailbox of a closed connection, or leave it to its worker if messages are pending.
+        void Forget(const ITCPConn<T>* pRemote) {
+            std::scoped_lock lock(m_mtxMailboxes);
+            auto it = m_mapMailboxes.find(pRemote);
+            if (it == m_mapMailboxes.end()) return;
+            std::scoped_lock lockMailbox(it->second->mutex);
+            if (!it->second->bScheduled) m_mapMailboxes.erase(it);
+        }
+
+        /// \brief Rethrow the first exception a handler threw on a worker since the last call, if any.
+        /// Called by the consumer of the incoming queue, so failures surface where they would without workers.
+        void RethrowError() {
+            std::exception_ptr pError;
+            {
+                std::scoped_lock lock(m_mtxError);
+                pError = std::exchange(m_pError, nullptr);
+            }
+            if (pError) std::rethrow_exception(pError);
+        }
+
+        /// \brief Stop and join the workers, messages not yet handled are discarded.
+        void Stop() {
+            if (m_bStopping.exchange(true)) return;
+            {
+                std::scoped_lock lock(m_mtxIdle);
+                m_cvIdle.notify_all();
+            }
+            for (auto& worker : m_workers)
+                if (worker.thread.joinable()) worker.thread.join();
+        }
+
+    protected:
+        struct Mailbox {
+            const ITCPConn<T>* pKey = nullptr;
+            std::weak_ptr<ITCPConn<T>> remote;
+            size_t nShard = 0;
+            std::mutex mutex;
+            std::vector<TCPMsgOwned<T>> pending;
+            bool bScheduled = false;
+        };
+
+        struct Worker {
+            std::mutex mutex;
+            std::deque<std::shared_ptr<Mailbox>> queue;
+            std::thread thread;
+        };
+
+        void Schedule(const std::shared_ptr<Mailbox>& pMailbox, size_t nWorker) {
+            {
+                std::scoped_lock lock(m_workers[nWorker].mutex);
+                m_workers[nWorker].queue.push_back(pMailbox);
+            }
+            // Sequentially consistent with the idle count so either side sees the other
+            m_nQueued.fetch_add(1);
+            if (m_nIdle.load() > 0) {
+                { std::scoped_lock lock(m_mtxIdle); }
+                m_cvIdle.notify_one();
+            }
+        }
+
+        /// \brief Own queue first (oldest first), then the newest mailbox of another worker.
+        std::shared_ptr<Mailbox> Take(size_t nWorker) {
+            std::shared_ptr<Mailbox> pMailbox;
+            for (size_t n = 0; n < m_workers.size() && !pMailbox; n++) {
+                auto& worker = m_workers[(nWorker + n) % m_workers.size()];
+                std::scoped_lock lock(worker.mutex);
+                if (worker.queue.empty()) continue;
+                if (n == 0) {
+                    pMailbox = std::move(worker.queue.front());
+                    worker.queue.pop_front();
+                } else {
+                    pMailbox = std::move(worker.queue.back());
+                    worker.queue.pop_back();
+                }
+            }
+            if (pMailbox) m_nQueued.fetch_sub(1, std::memory_order_relaxed);
+            return pMailbox;
+        }
+
+        void Work(size_t nWorker) {
+            std::vector<TCPMsgOwned<T>> vecBatch;
+            while (!m_bStopping) {
+                auto pMailbox = Take(nWorker);
+                if (!pMailbox) {
+                    std::unique_lock<std::mutex> ul(m_mtxIdle);
+                    m_nIdle.fetch_add(1);
+                    // Schedule() notifies whenever it sees an idle worker, no polling needed
+                    m_cvIdle.wait(ul, [this]() { return m_bStopping || m_nQueued.load() > 0; });
+                    m_nIdle.fetch_sub(1);
+                    continue;
+                }
+                {
+                    std::scoped_lock lock(pMailbox->mutex);
+                    vecBatch.swap(pMailbox->pending);
+                }
+                // A throwing handler loses the rest of its batch, as on the Update() thread, and the worker carries on
+                try {
+                    m_handler(vecBatch);
+                } catch (...) {
+                    KeepError(std::current_exception());
+                }
+                vecBatch.clear();
+
+                bool bMore;
+                {
+                    std::scoped_lock lock(pMailbox->mutex);
+                    bMore = !pMailbox->pending.empty();
+                    if (!bMore) pMailbox->bScheduled = false;
+                }
+                // Back of the own queue, so other connections of this worker get their turn
+                if (bMore) Schedule(pMailbox, nWorker);
+                else if (auto remote = pMailbox->remote.lock(); !remote || !remote->IsConnected())
+                    Retire(pMailbox);
+            }
+        }
+
+        /// \brief Keep the first failure for RethrowError(), log the ones following before it is taken.
+        void KeepError(std::exception_ptr pError) {
+            {
+                std::scoped_lock lock(m_mtxError);
+                if (!m_pError) {
+                    m_pError = std::move(pError);
+                    return;
+                }
+            }
+            try {
+                std::rethrow_exception(pError);
+            } catch (const std::exception& e) {
+                ERROR_MSG("[SERVER] Message handler failed on a dispatch thread: {}", e.what());
+            } catch (...) {
+                ERROR_MSG("[SERVER] Message handler failed on a dispatch thread.");
+            }
+        }
+
+        /// \brief Drop the mailbox of a closed connection once it is idle.
+        void Retire(const std::shared_ptr<Mailbox>& pMailbox) {
+            std::scoped_lock lock(m_mtxMailboxes);
+            auto it = m_mapMailboxes.find(pMailbox->pKey);
+            if (it == m_mapMailboxes.end() || it->second != pMailbox) return;
+            std::scoped_lock lockMailbox(pMailbox->mutex);
+            if (!pMailbox->bScheduled) m_mapMailboxes.erase(it);
+        }
+
+        Handler m_handler;
+        std::vector<Worker> m_workers;
+        std::mutex m_mtxMailboxes;
+        std::unordered_map<const ITCPConn<T>*, std::shared_ptr<Mailbox>> m_mapMailboxes;
+        std::atomic<size_t> m_nQueued{0};
+        std::atomic<size_t> m_nIdle{0};
+        std::mutex m_mtxIdle;
+        std::condition_variable m_cvIdle;
+        std::atomic<bool> m_bStopping{false};
+        std::mutex m_mtxError;
+        std::exception_ptr m_pError;  // first handler failure not rethrown yet
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPDISPATCHPOOL_H
@@ -0,0 +1,129 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPIOENGINE_H
+#define TCPCONN_TCPIOENGINE_H
+
+#include "LogMacros.h"
+#include <boost/asio.hpp>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+#ifdef TCPCONN_HAS_IO_URING
+#include <liburing.h>
+#endif
+
+namespace TCPConn {
+
+    // Asio picks its backend at compile time, TCPCONN_HAS_IO_URING comes with BOOST_ASIO_HAS_IO_URING
+    // and BOOST_ASIO_DISABLE_EPOLL, so sockets run on the io_uring proactor instead of the epoll reactor
+#ifdef TCPCONN_HAS_IO_URING
+#if BOOST_VERSION < 107800
+#error "TCPCONN_HAS_IO_URING needs Asio io_uring support from Boost 1.78 or later"
+#endif
+    inline constexpr bool TCPCONN_IO_URING_ENABLED = true;
+#else
+    inline constexpr bool TCPCONN_IO_URING_ENABLED = false;
+#endif
+
+    /// \brief Concurrency hint the io_contexts are constructed with, after checking the engine can run here.
+    /// CMake probes io_uring on the build host only and a built library cannot fall back to epoll, so an
+    /// io_uring build checks once that the running kernel can set up a ring.
+    /// \throw std::system_error naming the option to rebuild with when it cannot
+    inline int IoContextHint() {
+#ifdef TCPCONN_HAS_IO_URING
+        static const int nError = []() {
+            io_uring ring;
+            int n = io_uring_queue_init(8, &ring, 0);
+            if (n == 0) io_uring_queue_exit(&ring);
+            return -n;
+        }();
+        if (nError != 0)
+            throw std::system_error(nError, std::system_category(),
+                                    "TCPConn was built for io_uring, which this kernel cannot set up. "
+                                    "Rebuild with -DTCPCONN_ENABLE_IO_URING=OFF to run on epoll");
+#endif
+        return BOOST_ASIO_CONCURRENCY_HINT_DEFAULT;
+    }
+
+    /// \brief Receive buffers of `EReadMode::buffered` connections, carved out of one slab.
+    /// With io_uring the slab is registered with the kernel once, so reads into it are issued as
+    /// fixed-buffer reads that skip pinning the pages on every call. Slots are taken by connections on
+    /// their first read and given back when they close; connections finding none left use plain buffers.
+    class TCPReadBufferSlab {
+    public:
+        /// \brief Construct a slab and register it with the io_context.
+        /// \param context io_context the connections reading into the slab run on
+        /// \param nSlots number of slots, one per connection
+        /// \param nSlotSize size of each slot in bytes
+        TCPReadBufferSlab([[maybe_unused]] boost::asio::io_context& context, size_t nSlots, size_t nSlotSize)
+                : m_nSlotSize(nSlotSize), m_vecMemory(nSlots * nSlotSize) {
+            m_vecFree.reserve(nSlots);
+            for (size_t i = nSlots; i > 0; i--) m_vecFree.push_back(int(i - 1));
+#ifdef TCPCONN_HAS_IO_URING
+            std::vector<boost::asio::mutable_buffer> vecBuffers;
+            vecBuffers.reserve(nSlots);
+            for (size_t i = 0; i < nSlots; i++) vecBuffers.emplace_back(Data(int(i)), m_nSlotSize);
+            try {
+                m_registration.emplace(boost::asio::register_buffers(context, vecBuffers));
+            } catch (std::exception& e) {
+                // E.g. RLIMIT_MEMLOCK on kernels before 5.12, the slots still serve as plain buffers
+                ERROR_MSG("Cannot register read buffers with io_uring: {}", e.what());
+            }
+#endif
+        }
+        TCPReadBufferSlab(const TCPReadBufferSlab&) = delete;
+
+        /// \brief Take a free slot.
+        /// \return slot index, -1 if all are taken
+        int Acquire() {
+            std::scoped_lock lock(m_mtx);
+            if (m_vecFree.empty()) return -1;
+            int nSlot = m_vecFree.back();
+            m_vecFree.pop_back();
+            return nSlot;
+        }
+
+        /// \brief Give a slot back.
+        void Release(int nSlot) {
+            std::scoped_lock lock(m_mtx);
+            m_vecFree.push_back(nSlot);
+        }
+
+        /// \brief Drop the kernel registration, must happen before the io_context is destroyed.
+        void Unregister() {
+#ifdef TCPCONN_HAS_IO_URING
+            m_registration.reset();
+#endif
+        }
+
+        [[nodiscard]] uint8_t* Data(int nSlot) { return m_vecMemory.data() + size_t(nSlot) * m_nSlotSize; }
+        [[nodiscard]] size_t SlotSize() const { return m_nSlotSize; }
+
+#ifdef TCPCONN_HAS_IO_URING
+        [[nodiscard]] bool Registered() const { return m_registration.has_value(); }
+
+        /// \brief Registered view of a slot from `nOffset` to its end, for a fixed-buffer read.
+        [[nodiscard]] boost::asio::mutable_registered_buffer Buffer(int nSlot, size_t nOffset) {
+            return (*m_registration)[size_t(nSlot)] + nOffset;
+        }
+#else
+        [[nodiscard]] bool Registered() const { return false; }
+#endif
+
+    private:
+        size_t m_nSlotSize;
+        std::vector<uint8_t> m_vecMemory;
+        std::mutex m_mtx;
+        std::vector<int> m_vecFree;
+#ifdef TCPCONN_HAS_IO_URING
+        std::optional<boost::asio::buffer_registration<std::vector<boost::asio::mutable_buffer>>> m_registration;
+#endif
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPIOENGINE_H
@@ -0,0 +1,203 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#include "TCPLog.h"
+#include "LogMacros.h"
+#include "TCPMsgQueue.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#define LOG_QUEUE_CAPACITY 8192
+
+namespace TCPConn {
+
+    namespace {
+
+        struct TCPLogEntry {
+            ELogLevel level = ELogLevel::info;
+            std::time_t time = 0;
+            std::string text;
+        };
+
+        const char* LevelName(ELogLevel level) {
+            switch (level) {
+                case ELogLevel::debug: return "DEBUG";
+                case ELogLevel::info: return "INFO";
+                case ELogLevel::error: return "ERROR";
+                default: return "";
+            }
+        }
+
+        /// \brief Records are pushed into a lock-free MPSC ring and written by one background thread,
+        /// a full ring drops records instead of blocking the io threads.
+        class TCPLogger {
+        public:
+            /// Never destroyed, so objects logging from static destructors stay safe.
+            static TCPLogger& Instance() {
+                static auto* pLogger = new TCPLogger();
+                return *pLogger;
+            }
+
+            bool Enabled(ELogLevel level) const {
+                return level >= m_eLevel.load(std::memory_order_relaxed);
+            }
+
+            void SetLevel(ELogLevel level) { m_eLevel.store(level, std::memory_order_relaxed); }
+            ELogLevel GetLevel() const { return m_eLevel.load(std::memory_order_relaxed); }
+
+            void Push(ELogLevel level, std::string&& text) {
+                TCPLogEntry entry{level, std::time(nullptr), std::move(text)};
+                if (m_queue.try_push_back(std::move(entry))) m_nPushed.fetch_add(1, std::memory_order_release);
+                else m_nDropped.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void SetSink(TCPLogSink sink) {
+                Flush();
+                std::scoped_lock lock(m_mtxSink);
+                m_sink = std::move(sink);
+            }
+
+            void Flush() {
+                uint64_t nTarget = m_nPushed.load(std::memory_order_acquire);
+                while (m_nWritten.load(std::memory_order_acquire) < nTarget && m_bDraining.load(std::memory_order_acquire))
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+
+        private:
+            TCPLogger() : m_queue(EQueueMode::mpsc, LOG_QUEUE_CAPACITY) {
+                try {
+                    std::thread([this]() { Drain(); }).detach();
+                } catch (const std::system_error& e) {
+                    m_bDraining.store(false, std::memory_order_release);
+                    std::fprintf(stderr, "Cannot start the logging thread, log records are discarded: %s\n", e.what());
+                }
+                std::atexit([]() { Instance().Flush(); });
+            }
+
+            void Drain() {
+                try {
+                    DrainLoop();
+                } catch (const std::exception& e) {
+                    std::fprintf(stderr, "Logging thread stopped, log records are discarded: %s\n", e.what());
+                }
+                // Flush() stops waiting for records nobody writes
+                m_bDraining.store(false, std::memory_order_release);
+            }
+
+            void DrainLoop() {
+                TCPLogEntry entry;
+                uint64_t nDroppedReported = 0;
+                for (;;) {
+                    m_queue.wait();
+                    std::scoped_lock lock(m_mtxSink);
+                    while (m_queue.try_pop_front(entry)) {
+                        Write(entry.level, entry.time, entry.text);
+                        m_nWritten.fetch_add(1, std::memory_order_release);
+                    }
+                    uint64_t nDropped = m_nDropped.load(std::memory_order_relaxed);
+                    if (nDropped != nDroppedReported) {
+                        Write(ELogLevel::error, std::time(nullptr),
+                              std::format("{} log records dropped, the log queue was full.", nDropped - nDroppedReported));
+                        nDroppedReported = nDropped;
+                    }
+                    if (!m_sink) std::fflush(stdout);
+                }
+            }
+
+            void Write(ELogLevel level, std::time_t time, const std::string& text) {
+                // Records arrive in bursts within the same second, the timestamp is formatted once per second
+                if (time != m_tCachedTime) {
+                    std::tm buf{};
+#ifdef _WIN32
+                    localtime_s(&buf, &time);
+#else
+                    localtime_r(&time, &buf);
+#endif
+                    char str[32];
+                    std::strftime(str, sizeof(str), "%Y-%m-%d %X", &buf);
+                    m_strCachedTime = str;
+                    m_tCachedTime = time;
+                }
+                m_strLine.clear();
+                m_strLine.append("[").append(m_strCachedTime).append("] [").append(LevelName(level)).append("] ").append(text);
+                if (m_sink) {
+                    // A throwing sink must not take down the logging thread, the line goes to stderr instead
+                    try {
+                        m_sink(level, m_strLine);
+                    } catch (const std::exception& e) {
+                        std::fprintf(stderr, "%s\n(log sink failed: %s)\n", m_strLine.c_str(), e.what());
+                    } catch (...) {
+                        std::fprintf(stderr, "%s\n(log sink failed)\n", m_strLine.c_str());
+                    }
+                } else {
+                    FILE* out = level == ELogLevel::error ? stderr : stdout;
+                    std::fputs(m_strLine.c_str(), out);
+                    std::fputc('\n', out);
+                }
+            }
+
+            TCPMsgQueue<TCPLogEntry> m_queue;
+            std::atomic<ELogLevel> m_eLevel{ELogLevel(TCPCONN_MIN_LOG_LEVEL)};
+            std::atomic<uint64_t> m_nPushed{0};
+            std::atomic<uint64_t> m_nWritten{0};
+            std::atomic<uint64_t> m_nDropped{0};
+            std::atomic<bool> m_bDraining{true};  // cleared if the logging thread never started or stopped
+
+            // Logging thread only, guarded by m_mtxSink against SetSink
+            std::mutex m_mtxSink;
+            TCPLogSink m_sink;
+            std::time_t m_tCachedTime = 0;
+            std::string m_strCachedTime;
+            std::string m_strLine;
+        };
+
+    }
+
+    bool LogEnabled(ELogLevel level) {
+        return TCPLogger::Instance().Enabled(level);
+    }
+
+    void LogRecord(ELogLevel level, std::string&& text) {
+        TCPLogger::Instance().Push(level, std::move(text));
+    }
+
+    void SetLogLevel(ELogLevel level) {
+        TCPLogger::Instance().SetLevel(level);
+    }
+
+    ELogLevel GetLogLevel() {
+        return TCPLogger::Instance().GetLevel();
+    }
+
+    void SetLogSink(TCPLogSink sink) {
+        TCPLogger::Instance().SetSink(std::move(sink));
+    }
+
+    TCPLogSink MakeFileLogSink(const std::string& path) {
+        std::shared_ptr<FILE> file(std::fopen(path.c_str(), "a"), [](FILE* f) { if (f) std::fclose(f); });
+        if (!file) return {};
+        return [file](ELogLevel, const std::string& line) {
+            std::fputs(line.c_str(), file.get());
+            std::fputc('\n', file.get());
+            std::fflush(file.get());
+        };
+    }
+
+    TCPLogSink MakeStderrLogSink() {
+        return [](ELogLevel, const std::string& line) {
+            std::fputs(line.c_str(), stderr);
+            std::fputc('\n', stderr);
+        };
+    }
+
+    void FlushLog() {
+        TCPLogger::Instance().Flush();
+    }
+
+} // TCPConn
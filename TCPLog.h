@@ -0,0 +1,51 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPLOG_H
+#define TCPCONN_TCPLOG_H
+
+#include "TCPMsg.h"
+#include <functional>
+#include <string>
+
+namespace TCPConn {
+
+    /// \brief Severity of a log record, records below the current level are discarded.
+    enum class ELogLevel {
+        debug,
+        info,
+        error,
+        off
+    };
+
+    /// \brief Receives every formatted log line (timestamp and level included, no trailing newline).
+    /// Called on the background logging thread only. A line whose sink throws is written to stderr instead.
+    using TCPLogSink = std::function<void(ELogLevel level, const std::string& line)>;
+
+    /// \brief Set the minimum level of records to keep, `info` by default.
+    /// Levels below `TCPCONN_MIN_LOG_LEVEL` are compiled out of the library and cannot be enabled here.
+    TCPCONN_API void SetLogLevel(ELogLevel level);
+
+    /// \brief Get the minimum level of records to keep.
+    TCPCONN_API ELogLevel GetLogLevel();
+
+    /// \brief Replace the sink, pending records are written to the previous one first.
+    /// \param sink new sink, empty to restore the console sink (stdout, errors to stderr)
+    TCPCONN_API void SetLogSink(TCPLogSink sink);
+
+    /// \brief Sink appending to a file.
+    /// \param path file to append to
+    /// \return the sink, or an empty sink if the file cannot be opened
+    TCPCONN_API TCPLogSink MakeFileLogSink(const std::string& path);
+
+    /// \brief Sink writing every record to stderr.
+    TCPCONN_API TCPLogSink MakeStderrLogSink();
+
+    /// \brief Block until every record logged so far has been written to the sink.
+    /// Returns at once if the logging thread is not running.
+    TCPCONN_API void FlushLog();
+
+} // TCPConn
+
+#endif //TCPCONN_TCPLOG_H
@@ -41,6 +41,10 @@ namespace TCPConn {
         uint32_t size{};
     };
 
+    /// \brief Bit set in `TCPMsgHeader::size` on the wire when the body is compressed.
+    /// Set and cleared by the connection, messages handed to `OnMessage` never carry it.
+    inline constexpr uint32_t TCPMSG_COMPRESSED_FLAG = 0x80000000u;
+
     struct TCPMsg {
         TCPMsgHeader header{};
         std::vector<uint8_t> body;
@@ -193,6 +197,10 @@ namespace TCPConn {
         }
     };
 
+    /// \brief Immutable message shared between several outgoing queues, e.g. for broadcasting.
+    template <typename T>
+    using TCPMsgShared = std::shared_ptr<const T>;
+
 } // TCPCon
 
 #endif //TCPCONN_TCPMSG_H
@@ -8,11 +8,26 @@
 #include <deque>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
 
 static_assert(std::atomic<bool>::is_always_lock_free);
 
 namespace TCPConn {
 
+    /// \brief Storage strategy of a `TCPMsgQueue`.
+    enum class EQueueMode {
+        locked,     ///< unbounded deque guarded by a mutex, any number of producers and consumers
+        spsc,       ///< bounded lock-free ring, single producer and single consumer
+        mpsc        ///< bounded lock-free ring, multiple producers and single consumer
+    };
+
     template<typename T>
     class TCPMsgQueue {
     public:
@@ -20,77 +35,305 @@ namespace TCPConn {
         TCPMsgQueue(const TCPMsgQueue<T>&) = delete;
         virtual ~TCPMsgQueue() { clear(); }
 
+        /// \brief Construct a queue with the given storage strategy.
+        /// \param mode locked deque or lock-free ring
+        /// \param nCapacity capacity of the ring, rounded up to a power of two, ignored for locked mode
+        explicit TCPMsgQueue(EQueueMode mode, size_t nCapacity = 4096) : m_eMode(mode) {
+            if (m_eMode == EQueueMode::locked) return;
+            size_t nSize = 2;
+            while (nSize < nCapacity) nSize <<= 1;
+            m_nMask = nSize - 1;
+            m_pRing = std::make_unique<Cell[]>(nSize);
+            for (size_t i = 0; i < nSize; i++) m_pRing[i].seq.store(i, std::memory_order_relaxed);
+        }
+
     public:
+        [[nodiscard]] EQueueMode mode() const { return m_eMode; }
+
+        /// Ring modes: consumer only, the queue must not be empty.
         const T& front() {
+            if (m_eMode != EQueueMode::locked)
+                return m_pRing[m_nHead.load(std::memory_order_relaxed) & m_nMask].value;
             std::scoped_lock lock(m_mutex);
             return m_queue.front();
         }
 
         const T& back() {
+            RequireLocked("back");
             std::scoped_lock lock(m_mutex);
             return m_queue.back();
         }
 
+        /// Ring modes: blocks (yielding) while the ring is full, drops the item after `exit_wait()`.
         void push_back(const T& item) {
-            std::scoped_lock lock(m_mutex);
-            m_queue.emplace_back(std::move(item));
+            if (m_eMode != EQueueMode::locked) {
+                T copy(item);
+                for (int nRetry = 0; !TryPushRing(copy); nRetry++) {
+                    if (m_bExiting) return;
+                    // Back off to sleeping so a descheduled consumer gets the core to drain the ring
+                    if (nRetry < 64) std::this_thread::yield();
+                    else std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                return;
+            }
+            {
+                std::scoped_lock lock(m_mutex);
+                m_queue.emplace_back(item);
+            }
+            // m_mutex must be released first, wait() evaluates empty() while holding m_mtxBlocking
+            { std::unique_lock<std::mutex> ul(m_mtxBlocking); }
+            m_cvBlocking.notify_one();
+        }
+
+        /// \brief Push by moving, the item is not copied.
+        void push_back(T&& item) {
+            if (m_eMode != EQueueMode::locked) {
+                for (int nRetry = 0; !TryPushRing(item); nRetry++) {
+                    if (m_bExiting) return;
+                    if (nRetry < 64) std::this_thread::yield();
+                    else std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                return;
+            }
+            {
+                std::scoped_lock lock(m_mutex);
+                m_queue.emplace_back(std::move(item));
+            }
             { std::unique_lock<std::mutex> ul(m_mtxBlocking); }
             m_cvBlocking.notify_one();
         }
 
+        /// \brief Push without blocking.
+        /// \return false if the ring is full, always true for locked mode
+        bool try_push_back(const T& item) {
+            if (m_eMode != EQueueMode::locked) {
+                T copy(item);
+                return TryPushRing(copy);
+            }
+            push_back(item);
+            return true;
+        }
+
+        bool try_push_back(T&& item) {
+            if (m_eMode != EQueueMode::locked) return TryPushRing(item);
+            push_back(std::move(item));
+            return true;
+        }
+
         void push_front(const T& item) {
-            std::scoped_lock lock(m_mutex);
-            m_queue.emplace_front(std::move(item));
+            RequireLocked("push_front");
+            {
+                std::scoped_lock lock(m_mutex);
+                m_queue.emplace_front(item);
+            }
+            // m_mutex must be released first, wait() evaluates empty() while holding m_mtxBlocking
+            { std::unique_lock<std::mutex> ul(m_mtxBlocking); }
+            m_cvBlocking.notify_one();
+        }
+
+        void push_front(T&& item) {
+            RequireLocked("push_front");
+            {
+                std::scoped_lock lock(m_mutex);
+                m_queue.emplace_front(std::move(item));
+            }
             { std::unique_lock<std::mutex> ul(m_mtxBlocking); }
             m_cvBlocking.notify_one();
         }
 
         bool empty() {
+            if (m_eMode != EQueueMode::locked) {
+                size_t nHead = m_nHead.load(std::memory_order_relaxed);
+                return m_pRing[nHead & m_nMask].seq.load(std::memory_order_acquire) != nHead + 1;
+            }
             std::scoped_lock lock(m_mutex);
             return m_queue.empty();
         }
 
+        /// Ring modes: approximate while producers are active.
         size_t count() {
+            if (m_eMode != EQueueMode::locked) {
+                size_t nHead = m_nHead.load(std::memory_order_relaxed);
+                size_t nTail = m_nTail.load(std::memory_order_relaxed);
+                return nTail > nHead ? nTail - nHead : 0;
+            }
             std::scoped_lock lock(m_mutex);
             return m_queue.size();
         }
 
+        /// Ring modes: consumer only.
         void clear() {
+            if (m_eMode != EQueueMode::locked) {
+                T item;
+                while (try_pop_front(item)) {}
+                return;
+            }
             std::scoped_lock lock(m_mutex);
             m_queue.clear();
         }
 
+        /// Ring modes: consumer only, the queue must not be empty.
         T pop_front() {
+            if (m_eMode != EQueueMode::locked) {
+                T item;
+                TryPopRing(item);
+                return item;
+            }
             std::scoped_lock lock(m_mutex);
             auto item = std::move(m_queue.front());
             m_queue.pop_front();
             return item;
         }
 
+        /// \brief Check and pop in one step, preferred for draining loops.
+        /// \param item receives the popped element
+        /// \return false if the queue was empty
+        bool try_pop_front(T& item) {
+            if (m_eMode != EQueueMode::locked) return TryPopRing(item);
+            std::scoped_lock lock(m_mutex);
+            if (m_queue.empty()) return false;
+            item = std::move(m_queue.front());
+            m_queue.pop_front();
+            return true;
+        }
+
+        /// \brief Pop up to nMax items in one step, appended to out in queue order.
+        /// Locked mode takes the lock once and swaps the whole deque out when it fits.
+        /// Ring modes: consumer only.
+        /// \return number of items popped
+        size_t try_pop_all(std::vector<T>& out, size_t nMax = -1) {
+            if (m_eMode != EQueueMode::locked) {
+                size_t nCount = 0;
+                T item;
+                while (nCount < nMax && TryPopRing(item)) {
+                    out.push_back(std::move(item));
+                    nCount++;
+                }
+                return nCount;
+            }
+            std::deque<T> pending;
+            {
+                std::scoped_lock lock(m_mutex);
+                if (m_queue.size() <= nMax) {
+                    pending.swap(m_queue);
+                } else {
+                    out.insert(out.end(), std::make_move_iterator(m_queue.begin()),
+                               std::make_move_iterator(m_queue.begin() + std::ptrdiff_t(nMax)));
+                    m_queue.erase(m_queue.begin(), m_queue.begin() + std::ptrdiff_t(nMax));
+                    return nMax;
+                }
+            }
+            // Moved out of the queue after releasing the lock
+            out.insert(out.end(), std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()));
+            return pending.size();
+        }
+
         T pop_back() {
+            RequireLocked("pop_back");
             std::scoped_lock lock(m_mutex);
             auto item = std::move(m_queue.back());
             m_queue.pop_back();
             return item;
         }
-        
+
         void wait() {
+            if (m_eMode != EQueueMode::locked) {
+                // Futex-backed wait, the first producer to see the consumer asleep wakes it
+                while (!m_bExiting) {
+                    m_bConsumerSleeping.store(true, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    uint32_t nSignal = m_nSignal.load(std::memory_order_acquire);
+                    if (!empty() || m_bExiting) break;
+                    m_nSignal.wait(nSignal, std::memory_order_acquire);
+                }
+                m_bConsumerSleeping.store(false, std::memory_order_relaxed);
+                return;
+            }
             std::unique_lock<std::mutex> ul(m_mtxBlocking);
             m_cvBlocking.wait(ul, [this](){ return !empty() || m_bExiting; });
         }
-        
+
         void exit_wait() {
+            if (m_eMode != EQueueMode::locked) {
+                m_bExiting = true;
+                m_nSignal.fetch_add(1);
+                m_nSignal.notify_all();
+                return;
+            }
             { std::unique_lock<std::mutex> ul(m_mtxBlocking); }
             m_bExiting = true;
             m_cvBlocking.notify_one();
         }
 
     protected:
+        struct Cell {
+            std::atomic<size_t> seq;
+            T value;
+        };
+
+        bool TryPushRing(T& item) {
+            size_t nPos = m_nTail.load(std::memory_order_relaxed);
+            Cell* pCell;
+            for (;;) {
+                pCell = &m_pRing[nPos & m_nMask];
+                size_t nSeq = pCell->seq.load(std::memory_order_acquire);
+                auto nDiff = intptr_t(nSeq) - intptr_t(nPos);
+                if (nDiff == 0) {
+                    if (m_eMode == EQueueMode::spsc) {
+                        m_nTail.store(nPos + 1, std::memory_order_relaxed);
+                        break;
+                    }
+                    if (m_nTail.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (nDiff < 0) {
+                    return false;
+                } else {
+                    nPos = m_nTail.load(std::memory_order_relaxed);
+                }
+            }
+            pCell->value = std::move(item);
+            pCell->seq.store(nPos + 1, std::memory_order_release);
+            // Pairs with the fence in wait(): either the consumer sees the item or we see it asleep
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_bConsumerSleeping.load(std::memory_order_relaxed) &&
+                m_bConsumerSleeping.exchange(false, std::memory_order_relaxed)) {
+                m_nSignal.fetch_add(1, std::memory_order_release);
+                m_nSignal.notify_one();
+            }
+            return true;
+        }
+
+        bool TryPopRing(T& item) {
+            size_t nPos = m_nHead.load(std::memory_order_relaxed);
+            Cell& cell = m_pRing[nPos & m_nMask];
+            if (cell.seq.load(std::memory_order_acquire) != nPos + 1) return false;
+            item = std::move(cell.value);
+            cell.seq.store(nPos + m_nMask + 1, std::memory_order_release);
+            m_nHead.store(nPos + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void RequireLocked(const char* op) const {
+            if (m_eMode != EQueueMode::locked)
+                throw std::logic_error(std::string(op) + " is only supported by locked message queues");
+        }
+
+        EQueueMode m_eMode = EQueueMode::locked;
+
+        // Locked mode
         std::mutex m_mutex;
         std::deque<T> m_queue;
         std::condition_variable m_cvBlocking;
         std::mutex m_mtxBlocking;
         std::atomic<bool> m_bExiting{false};
+
+        // Ring modes
+        std::unique_ptr<Cell[]> m_pRing;
+        size_t m_nMask = 0;
+        alignas(64) std::atomic<size_t> m_nTail{0};
+        alignas(64) std::atomic<size_t> m_nHead{0};
+        alignas(64) std::atomic<uint32_t> m_nSignal{0};
+        std::atomic<bool> m_bConsumerSleeping{false};
     };
 
 } // TCPConn
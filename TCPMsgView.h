@@ -0,0 +1,189 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPMSGVIEW_H
+#define TCPCONN_TCPMSGVIEW_H
+
+#include "TCPMsg.h"
+#include <span>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <type_traits>
+
+namespace TCPConn {
+
+    /// \brief Non-owning cursor reading a message body front to back.
+    /// Unlike `TCPMsg::operator>>`, fields are read in the order they were written and the
+    /// message is left untouched. Every read is bounds checked and throws `std::out_of_range`.
+    class TCPMsgView {
+    public:
+        explicit TCPMsgView(std::span<const uint8_t> data) : m_data(data) {}
+        explicit TCPMsgView(const TCPMsg& msg) : m_data(msg.body) {}
+        explicit TCPMsgView(const TCPRawMsg& msg) : m_data(msg.body) {}
+
+        [[nodiscard]] size_t position() const { return m_nPos; }
+        [[nodiscard]] size_t remaining() const { return m_data.size() - m_nPos; }
+        [[nodiscard]] bool empty() const { return remaining() == 0; }
+
+        /// \brief Read a standard-layout value by copy.
+        template <typename T>
+        T read() {
+            static_assert(std::is_standard_layout<T>::value && std::is_trivially_copyable<T>::value,
+                          "Data layout is not standard. Read structure content separately.");
+            T data;
+            std::memcpy(&data, take(sizeof(T)), sizeof(T));
+            return data;
+        }
+
+        template <typename T>
+        friend TCPMsgView& operator >> (TCPMsgView& view, T& data) {
+            data = view.read<T>();
+            return view;
+        }
+
+        /// \brief Read a string written by `TCPMsgWriter::write_string()`.
+        friend TCPMsgView& operator >> (TCPMsgView& view, std::string& data) {
+            data = view.read_string();
+            return view;
+        }
+
+        /// \brief Sub-span of the next bytes, no copy.
+        /// \param nBytes number of bytes
+        std::span<const uint8_t> read_bytes(size_t nBytes) {
+            return {take(nBytes), nBytes};
+        }
+
+        /// \brief Next bytes viewed as characters, no copy.
+        /// \param nLength number of characters
+        std::string_view read_string(size_t nLength) {
+            return {reinterpret_cast<const char*>(take(nLength)), nLength};
+        }
+
+        /// \brief Next length-prefixed string viewed as characters, no copy.
+        /// Reads the `uint32_t` length written by `TCPMsgWriter::write_string()`, then the characters.
+        std::string_view read_string() {
+            return read_string(read<uint32_t>());
+        }
+
+        /// \brief Next elements viewed in place, no copy.
+        /// Throws `std::runtime_error` if the data is not suitably aligned for `T`, use `read_vector()` then.
+        /// \param nCount number of elements
+        template <typename T>
+        std::span<const T> read_span(size_t nCount) {
+            static_assert(std::is_standard_layout<T>::value && std::is_trivially_copyable<T>::value,
+                          "Element layout is not standard.");
+            if (nCount > remaining() / sizeof(T)) throw std::out_of_range("TCPMsgView: read past end of message");
+            const uint8_t* pData = m_data.data() + m_nPos;
+            if (reinterpret_cast<uintptr_t>(pData) % alignof(T) != 0)
+                throw std::runtime_error("TCPMsgView: misaligned span, use read_vector()");
+            m_nPos += nCount * sizeof(T);
+            return {reinterpret_cast<const T*>(pData), nCount};
+        }
+
+        /// \brief Next elements copied into a vector, works for any alignment.
+        /// \param nCount number of elements
+        template <typename T>
+        std::vector<T> read_vector(size_t nCount) {
+            static_assert(std::is_standard_layout<T>::value && std::is_trivially_copyable<T>::value,
+                          "Element layout is not standard.");
+            if (nCount > remaining() / sizeof(T)) throw std::out_of_range("TCPMsgView: read past end of message");
+            std::vector<T> data(nCount);
+            std::memcpy(data.data(), take(nCount * sizeof(T)), nCount * sizeof(T));
+            return data;
+        }
+
+        /// \brief Skip bytes.
+        void skip(size_t nBytes) { take(nBytes); }
+
+        /// \brief Everything not read yet, no copy.
+        [[nodiscard]] std::span<const uint8_t> rest() const { return m_data.subspan(m_nPos); }
+
+    protected:
+        const uint8_t* take(size_t nBytes) {
+            if (nBytes > remaining()) throw std::out_of_range("TCPMsgView: read past end of message");
+            const uint8_t* pData = m_data.data() + m_nPos;
+            m_nPos += nBytes;
+            return pData;
+        }
+
+        std::span<const uint8_t> m_data;
+        size_t m_nPos = 0;
+    };
+
+    /// \brief Cursor appending to a message body front to back, the counterpart of `TCPMsgView`.
+    /// Reserves once on construction and keeps `header.size` of a `TCPMsg` up to date.
+    template <typename TMsg>
+    class TCPMsgWriter {
+    public:
+        /// \brief Construct a writer appending to a message.
+        /// \param msg message to append to
+        /// \param nReserve bytes expected to be written, reserved up front
+        explicit TCPMsgWriter(TMsg& msg, size_t nReserve = 0) : m_msg(msg) {
+            m_msg.body.reserve(m_msg.body.size() + nReserve);
+        }
+
+        /// \brief Append a standard-layout value.
+        template <typename T>
+        TCPMsgWriter& write(const T& data) {
+            static_assert(std::is_standard_layout<T>::value && std::is_trivially_copyable<T>::value,
+                          "Data layout is not standard. Write structure content separately.");
+            return write_bytes(&data, sizeof(T));
+        }
+
+        /// \brief Append a contiguous range of standard-layout elements.
+        template <typename T>
+        TCPMsgWriter& write(std::span<const T> data) {
+            static_assert(std::is_standard_layout<T>::value && std::is_trivially_copyable<T>::value,
+                          "Element layout is not standard.");
+            return write_bytes(data.data(), data.size_bytes());
+        }
+
+        /// \brief Append characters, without terminator or length prefix.
+        TCPMsgWriter& write(std::string_view data) {
+            return write_bytes(data.data(), data.size());
+        }
+
+        /// \brief Append a `uint32_t` length, then the characters without terminator.
+        /// The characters are laid out as `TCPMsg` stores a string, the length lets readers size it.
+        TCPMsgWriter& write_string(std::string_view data) {
+            write(uint32_t(data.size()));
+            return write(data);
+        }
+
+        /// \brief Append raw bytes.
+        TCPMsgWriter& write_bytes(const void* pData, size_t nBytes) {
+            auto pBytes = static_cast<const uint8_t*>(pData);
+            m_msg.body.insert(m_msg.body.end(), pBytes, pBytes + nBytes);
+            if constexpr (std::is_same<TMsg, TCPMsg>::value) m_msg.header.size = uint32_t(m_msg.full_size());
+            return *this;
+        }
+
+        template <typename T>
+        friend TCPMsgWriter& operator << (TCPMsgWriter& writer, const T& data) {
+            return writer.write(data);
+        }
+
+        // Strings are length-prefixed, see write_string()
+        friend TCPMsgWriter& operator << (TCPMsgWriter& writer, std::string_view data) {
+            return writer.write_string(data);
+        }
+
+        friend TCPMsgWriter& operator << (TCPMsgWriter& writer, const std::string& data) {
+            return writer.write_string(data);
+        }
+
+        friend TCPMsgWriter& operator << (TCPMsgWriter& writer, const char* data) {
+            return writer.write_string(data);
+        }
+
+        [[nodiscard]] size_t size() const { return m_msg.body.size(); }
+
+    protected:
+        TMsg& m_msg;
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPMSGVIEW_H
@@ -0,0 +1,160 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPOUTGOINGLIMITER_H
+#define TCPCONN_TCPOUTGOINGLIMITER_H
+
+#include "TCPConnConfig.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace TCPConn {
+
+    /// \brief Bounds the outgoing queue of one connection in messages and bytes.
+    /// Senders reserve room with `Admit()` on their own thread before posting to the io thread,
+    /// the io thread gives it back with `Release()` once messages are written or dropped.
+    class TCPOutgoingLimiter {
+    public:
+        enum class EAdmit {
+            queue,      ///< room reserved, queue the message
+            drop,       ///< discard the message
+            disconnect  ///< discard the message and close the connection
+        };
+
+        explicit TCPOutgoingLimiter(const TCPConnConfig& config)
+            : m_nMaxMessages(config.max_outgoing_messages), m_nMaxBytes(config.max_outgoing_bytes),
+              m_nHighWatermark(config.outgoing_high_watermark_bytes),
+              m_nLowWatermark(std::min(config.outgoing_low_watermark_bytes, config.outgoing_high_watermark_bytes)),
+              m_ePolicy(config.outgoing_overflow_policy),
+              m_bTracking(m_nMaxMessages > 0 || m_nMaxBytes > 0 || m_nHighWatermark > 0) {}
+        TCPOutgoingLimiter(const TCPOutgoingLimiter&) = delete;
+
+        void SetPolicy(EOverflowPolicy policy) { m_ePolicy.store(policy, std::memory_order_relaxed); }
+        [[nodiscard]] EOverflowPolicy GetPolicy() const { return m_ePolicy.load(std::memory_order_relaxed); }
+
+        /// \brief Reserve room for a message, called on the sending thread.
+        /// \param nBytes size of the message
+        /// \param bCanBlock false on an io thread, where `block` falls back to dropping
+        /// \param IsOpen connection state, a blocked sender gives up once it turns false
+        template <typename F>
+        EAdmit Admit(size_t nBytes, bool bCanBlock, F&& IsOpen) {
+            if (!m_bTracking) return EAdmit::queue;
+            if (m_nMaxMessages == 0 && m_nMaxBytes == 0) {
+                Reserve(nBytes);
+                return EAdmit::queue;
+            }
+            if (TryReserve(nBytes)) return EAdmit::queue;
+            switch (GetPolicy()) {
+                case EOverflowPolicy::drop_oldest:
+                    // The io thread trims the front of the queue after pushing
+                    Reserve(nBytes);
+                    return EAdmit::queue;
+                case EOverflowPolicy::disconnect:
+                    m_nDropped.fetch_add(1, std::memory_order_relaxed);
+                    return EAdmit::disconnect;
+                case EOverflowPolicy::block:
+                    if (bCanBlock && Wait(nBytes, IsOpen)) return EAdmit::queue;
+                    break;
+                case EOverflowPolicy::drop_newest:
+                    break;
+            }
+            m_nDropped.fetch_add(1, std::memory_order_relaxed);
+            return EAdmit::drop;
+        }
+
+        /// \brief Give room back, called on the io thread for written and dropped messages.
+        void Release(size_t nMessages, size_t nBytes) {
+            if (!m_bTracking) return;
+            m_nMessages.fetch_sub(nMessages, std::memory_order_relaxed);
+            m_nBytes.fetch_sub(nBytes, std::memory_order_relaxed);
+            if (m_nBlocked.load(std::memory_order_relaxed) > 0) {
+                { std::unique_lock<std::mutex> ul(m_mtxBlocking); }
+                m_cvBlocking.notify_all();
+            }
+        }
+
+        /// \brief Count a message discarded by the io thread under `drop_oldest`.
+        void Dropped(size_t nBytes) {
+            m_nDropped.fetch_add(1, std::memory_order_relaxed);
+            Release(1, nBytes);
+        }
+
+        /// \brief Whether the reserved room exceeds the limits, used by the io thread for `drop_oldest`.
+        [[nodiscard]] bool OverLimit() const {
+            return Exceeds(m_nMessages.load(std::memory_order_relaxed), m_nBytes.load(std::memory_order_relaxed));
+        }
+
+        /// \brief Track the watermarks, called on the io thread after the queue changed.
+        /// \return +1 when the high watermark was reached, -1 when the low one was reached again, 0 otherwise
+        int CheckWatermarks() {
+            if (m_nHighWatermark == 0) return 0;
+            size_t nBytes = m_nBytes.load(std::memory_order_relaxed);
+            if (!m_bBackpressure && nBytes >= m_nHighWatermark) {
+                m_bBackpressure = true;
+                return 1;
+            }
+            if (m_bBackpressure && nBytes <= m_nLowWatermark) {
+                m_bBackpressure = false;
+                return -1;
+            }
+            return 0;
+        }
+
+        [[nodiscard]] uint64_t DroppedMessages() const { return m_nDropped.load(std::memory_order_relaxed); }
+
+    protected:
+        [[nodiscard]] bool Exceeds(size_t nMessages, size_t nBytes) const {
+            return (m_nMaxMessages > 0 && nMessages > m_nMaxMessages) || (m_nMaxBytes > 0 && nBytes > m_nMaxBytes);
+        }
+
+        void Reserve(size_t nBytes) {
+            m_nMessages.fetch_add(1, std::memory_order_relaxed);
+            m_nBytes.fetch_add(nBytes, std::memory_order_relaxed);
+        }
+
+        bool TryReserve(size_t nBytes) {
+            size_t nMessages = m_nMessages.fetch_add(1, std::memory_order_relaxed) + 1;
+            size_t nTotal = m_nBytes.fetch_add(nBytes, std::memory_order_relaxed) + nBytes;
+            // A lone message always fits, otherwise it could never be sent
+            if (nMessages == 1 || !Exceeds(nMessages, nTotal)) return true;
+            m_nMessages.fetch_sub(1, std::memory_order_relaxed);
+            m_nBytes.fetch_sub(nBytes, std::memory_order_relaxed);
+            return false;
+        }
+
+        template <typename F>
+        bool Wait(size_t nBytes, F&& IsOpen) {
+            m_nBlocked.fetch_add(1, std::memory_order_relaxed);
+            bool bReserved = false;
+            std::unique_lock<std::mutex> ul(m_mtxBlocking);
+            // Timed wait, a connection closed by the io thread does not notify
+            while (!(bReserved = TryReserve(nBytes)) && IsOpen())
+                m_cvBlocking.wait_for(ul, std::chrono::milliseconds(10));
+            m_nBlocked.fetch_sub(1, std::memory_order_relaxed);
+            return bReserved;
+        }
+
+        const size_t m_nMaxMessages;
+        const size_t m_nMaxBytes;
+        const size_t m_nHighWatermark;
+        const size_t m_nLowWatermark;
+        std::atomic<EOverflowPolicy> m_ePolicy;
+        const bool m_bTracking;     // without limits and watermarks nothing is counted
+
+        std::atomic<size_t> m_nMessages{0};
+        std::atomic<size_t> m_nBytes{0};
+        std::atomic<uint64_t> m_nDropped{0};
+        bool m_bBackpressure = false;   // io thread only
+
+        std::mutex m_mtxBlocking;
+        std::condition_variable m_cvBlocking;
+        std::atomic<int> m_nBlocked{0};
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPOUTGOINGLIMITER_H
@@ -7,6 +7,8 @@
 
 #include "TCPMsg.h"
 #include "TCPMsgQueue.h"
+#include "TCPConnConfig.h"
+#include <span>
 
 namespace TCPConn {
     
@@ -25,6 +27,10 @@ namespace TCPConn {
 
         /// \brief Construct a TCP header-less message sender.
         ITCPRawMsgSender();
+
+        /// \brief Construct a TCP header-less message sender with custom connection tunables.
+        /// \param config tunables applied to the connection
+        explicit ITCPRawMsgSender(const TCPConnConfig& config);
         
         /// \brief Construct a TCP header message sender.
         /// \param header_size size of the header
@@ -32,20 +38,21 @@ namespace TCPConn {
         /// \param length_size size (in byte) of the length field in the header
         /// \param length_include_header whether the length field includes the header size
         /// \param endian_flip whether to flip the endian of the length field 
+        /// \param config tunables applied to the connection
         ITCPRawMsgSender(int header_size, int length_offset, int length_size,
-                         bool length_include_header, bool endian_flip);
+                         bool length_include_header, bool endian_flip, const TCPConnConfig& config = {});
         
         virtual ~ITCPRawMsgSender();
 
         
         /// \brief Connect to a raw message recipient
-        /// \param host server address or domain name
-        /// \param port server port
+        /// \param host server address or domain name, or `unix:/path/to.sock` / `unix:@name` for a Unix domain socket
+        /// \param port server port, ignored for Unix domain sockets
         bool Connect(const std::string& host, uint16_t port);
 
         /// \brief Connect to a raw message recipient
-        /// \param host server address or domain name
-        /// \param port server port
+        /// \param host server address or domain name, or `unix:/path/to.sock` / `unix:@name` for a Unix domain socket
+        /// \param port server port, ignored for Unix domain sockets
         bool Connect(const char* host, uint16_t port);
 
         /// \brief Disconnect from the server, will be called automatically on destruction
@@ -55,11 +62,19 @@ namespace TCPConn {
         /// \return true if the socket is open
         [[nodiscard]] bool IsConnected() const;
 
+        /// \brief Get the effective socket options as reported by the kernel, see `TCPConnConfig::socket_options`.
+        /// \return options of the socket, all unset if it is closed
+        [[nodiscard]] TCPSocketOptions GetSocketOptions() const;
+
         
         /// \brief Send a message to the server.
         /// \param msg message to send
         void Send(const TCPRawMsg& msg) const;
 
+        /// \brief Send a message to the server, its body is moved rather than copied.
+        /// \param msg message to send
+        void Send(TCPRawMsg&& msg) const;
+
         /// \brief Send a raw msg to the server.
         /// \param msg message to send
         void Send(const uint8_t* raw_msg, uint32_t length) const;
@@ -81,10 +96,26 @@ namespace TCPConn {
         /// \brief On disconnection from server.
         virtual void OnDisconnected() {}
 
+        /// \brief On the outgoing queue reaching `TCPConnConfig::outgoing_high_watermark_bytes`.
+        /// Called on the io thread, producers should hold back messages.
+        virtual void OnBackpressure() {}
+
+        /// \brief On the outgoing queue draining to `TCPConnConfig::outgoing_low_watermark_bytes` after `OnBackpressure`.
+        /// Called on the io thread.
+        virtual void OnWritable() {}
+
         /// \brief On message received, must be overridden.
         /// \param msg received message
         virtual void OnMessage(TCPRawMsg& msg) = 0;
 
+        /// \brief On a batch of messages drained by one `Update()`, in arrival order.
+        /// Override to process the batch at once, by default each message is passed to `OnMessage`.
+        /// Message bodies are recycled once this returns, move them out to keep them.
+        /// \param msgs received messages
+        virtual void OnMessageBatch(std::span<TCPRawMsg> msgs) {
+            for (auto& msg : msgs) OnMessage(msg);
+        }
+
     private:
         std::unique_ptr<TCPRawMsgSenderImpl> pimpl;
     };
@@ -14,16 +14,20 @@ namespace TCPConn {
     /* ----- ITCPRawMsgSender ----- */
 
     ITCPRawMsgSender::ITCPRawMsgSender() {
-        pimpl = std::make_unique<TCPRawMsgSenderImpl>(*this, ERawMsgType::no_header);
+        pimpl = std::make_unique<TCPRawMsgSenderImpl>(*this, ERawMsgType::no_header, TCPConnConfig{});
+    }
+
+    ITCPRawMsgSender::ITCPRawMsgSender(const TCPConnConfig& config) {
+        pimpl = std::make_unique<TCPRawMsgSenderImpl>(*this, ERawMsgType::no_header, config);
     }
 
     ITCPRawMsgSender::ITCPRawMsgSender(int header_size, int length_offset, int length_size,
-                                       bool length_include_header, bool endian_flip) {
+                                       bool length_include_header, bool endian_flip, const TCPConnConfig& config) {
         if (length_size != 1 && length_size != 2 && length_size != 4)
             throw std::invalid_argument("Length size must be 1, 2, or 4!");
         if (header_size <= 0 || length_offset <= 0 || length_offset + length_size > header_size)
             throw std::invalid_argument("Header properties are invalid!");
-        pimpl = std::make_unique<TCPRawMsgSenderImpl>(*this, ERawMsgType::with_header, header_size, 
+        pimpl = std::make_unique<TCPRawMsgSenderImpl>(*this, ERawMsgType::with_header, config, header_size, 
                                                       length_offset, length_size, length_include_header, endian_flip);
     }
 
@@ -45,14 +49,22 @@ namespace TCPConn {
         return pimpl->IsConnected();
     }
 
+    TCPSocketOptions ITCPRawMsgSender::GetSocketOptions() const {
+        return pimpl->GetSocketOptions();
+    }
+
     void ITCPRawMsgSender::Send(const TCPRawMsg &msg) const {
         pimpl->Send(msg);
     }
 
+    void ITCPRawMsgSender::Send(TCPRawMsg &&msg) const {
+        pimpl->Send(std::move(msg));
+    }
+
     void ITCPRawMsgSender::Send(const uint8_t *raw_msg, uint32_t length) const {
         TCPRawMsg msg;
         msg.body.assign(raw_msg, raw_msg + length);
-        pimpl->Send(msg);
+        pimpl->Send(std::move(msg));
     }
 
     void ITCPRawMsgSender::Update(size_t nMaxMessages, bool bWait) {
@@ -69,9 +81,11 @@ namespace TCPConn {
     std::atomic<bool> TCPRawMsgSenderImpl::m_bShuttingDown = false;
     
     TCPRawMsgSenderImpl::TCPRawMsgSenderImpl(ITCPRawMsgSender &interface, ITCPRawMsgSender::ERawMsgType msg_type,
-                                             int header_size, int length_offset, int length_size, 
+                                             const TCPConnConfig& config, int header_size, int length_offset, int length_size, 
                                              bool length_include_header, bool endian_flip) 
-        : _interface(interface), m_socket(m_context), m_eMsgType(msg_type),
+        : _interface(interface), m_context(IoContextHint()), m_socket(m_context), m_eMsgType(msg_type), m_config(config), m_limiter(config),
+          m_qMessagesIn(config.incoming_queue_mode, config.incoming_queue_capacity),
+          m_bufferPool(config.receive_pool_buffers_per_class),
           m_nHeaderSize(header_size), m_nLengthOffset(length_offset), m_nLengthSize(length_size),
           m_bEndianFlip(endian_flip), m_bLengthIncludeHeader(length_include_header) {}
 
@@ -86,12 +100,13 @@ namespace TCPConn {
             return false;
         }
         try {
-            ip::tcp::resolver resolver(m_context);
-            ip::tcp::resolver::results_type endpoint = resolver.resolve(host, std::to_string(port));
+            std::vector<TCPStreamEndpoint> endpoint = ResolveEndpoints(m_context, host, port);
             async_connect(m_socket, endpoint, 
-                    [this](std::error_code ec, ip::tcp::endpoint endpoint) {
+                    [this](std::error_code ec, const TCPStreamEndpoint& endpoint) {
                         if (!ec) {
-                            INFO_MSG("Connected to: {}", endpoint.address().to_string());
+                            INFO_MSG("Connected to: {}", EndpointToString(endpoint));
+                            ApplySocketOptions(m_socket, m_config.socket_options);
+                            m_bQuickAck = m_config.socket_options.quick_ack.value_or(false) && IsTcpSocket(m_socket);
                             auto async_call = std::async(std::launch::async, [this]() { _interface.OnConnected(); });
                             if (m_eMsgType == ITCPRawMsgSender::ERawMsgType::no_header) ReadRaw();
                             else ReadHeader();
@@ -126,25 +141,64 @@ namespace TCPConn {
         return m_socket.is_open();
     }
 
+    TCPSocketOptions TCPRawMsgSenderImpl::GetSocketOptions() const {
+        return ReadSocketOptions(m_socket);
+    }
+
     void TCPRawMsgSenderImpl::Send(const TCPRawMsg &msg) {
+        Send(TCPRawMsg(msg));
+    }
+
+    void TCPRawMsgSenderImpl::Send(TCPRawMsg &&msg) {
+        if (m_config.capture) m_config.capture->Record(ECaptureDirection::outbound, 0, msg);
+        // Blocking the io thread could stall the very writes that free the queue
+        bool bCanBlock = !m_context.get_executor().running_in_this_thread();
+        switch (m_limiter.Admit(msg.full_size(), bCanBlock, [this]() { return IsConnected(); })) {
+            case TCPOutgoingLimiter::EAdmit::queue:
+                break;
+            case TCPOutgoingLimiter::EAdmit::drop:
+                return;
+            case TCPOutgoingLimiter::EAdmit::disconnect:
+                INFO_MSG("Outgoing queue full, closing connection.");
+                post(m_context, [this]() { m_socket.close(); });
+                return;
+        }
         post(m_context,
-             [this, msg]() {
+             [this, msg = std::move(msg)]() mutable {
                  bool bWritingMessage = !m_qMessagesOut.empty();
-                 m_qMessagesOut.push_back(msg);
+                 m_qMessagesOut.push_back(std::move(msg));
+                 if (bWritingMessage) TrimOutgoingMessages();
+                 NotifyWatermarks();
                  if (!bWritingMessage) {
-                     WriteRaw();
+                     WriteMessages();
                  }
              });
     }
 
+    void TCPRawMsgSenderImpl::TrimOutgoingMessages() {
+        if (m_limiter.GetPolicy() != EOverflowPolicy::drop_oldest) return;
+        // The first m_nMessagesWriting messages are referenced by the write in flight, the newest is kept
+        while (m_limiter.OverLimit() && m_qMessagesOut.size() > m_nMessagesWriting + 1) {
+            auto it = m_qMessagesOut.begin() + std::ptrdiff_t(m_nMessagesWriting);
+            m_limiter.Dropped(it->full_size());
+            m_qMessagesOut.erase(it);
+        }
+    }
+
+    void TCPRawMsgSenderImpl::NotifyWatermarks() {
+        int nCrossed = m_limiter.CheckWatermarks();
+        if (nCrossed > 0) _interface.OnBackpressure();
+        else if (nCrossed < 0) _interface.OnWritable();
+    }
+
     void TCPRawMsgSenderImpl::Update(size_t nMaxMessages, bool bWait) {
         if (bWait) m_qMessagesIn.wait();
-        size_t nMessageCount = 0;
-        while (nMessageCount < nMaxMessages && !m_qMessagesIn.empty()) {
-            auto msg = m_qMessagesIn.pop_front();
-            _interface.OnMessage(msg);
-            nMessageCount++;
-        }
+        // Reused across calls, Update() may run on several threads for locked queues
+        thread_local std::vector<TCPRawMsg> vecBatch;
+        if (m_qMessagesIn.try_pop_all(vecBatch, nMaxMessages) == 0) return;
+        _interface.OnMessageBatch(std::span<TCPRawMsg>(vecBatch));
+        for (auto& msg : vecBatch) m_bufferPool.Release(std::move(msg.body));
+        vecBatch.clear();
     }
 
     void TCPRawMsgSenderImpl::Run() {
@@ -168,7 +222,8 @@ namespace TCPConn {
     }
 
     void TCPRawMsgSenderImpl::ReadRaw() {
-        m_msgTemporaryIn.body.resize(RAW_RECEIVE_BUFFER_SIZE);
+        if (m_bQuickAck) RearmQuickAck(m_socket);
+        m_msgTemporaryIn.body = m_bufferPool.Acquire(RAW_RECEIVE_BUFFER_SIZE);
         m_socket.async_receive(buffer(m_msgTemporaryIn.body.data(), RAW_RECEIVE_BUFFER_SIZE),
                 [this](std::error_code ec, std::size_t length) {
                     if (!ec) {
@@ -182,13 +237,22 @@ namespace TCPConn {
     }
 
     void TCPRawMsgSenderImpl::ReadHeader() {
-        m_msgTemporaryIn.body.resize(m_nHeaderSize);
+        if (m_bQuickAck) RearmQuickAck(m_socket);
+        m_msgTemporaryIn.body = m_bufferPool.Acquire(m_nHeaderSize);
         async_read(m_socket, buffer(m_msgTemporaryIn.body.data(), m_nHeaderSize),
                    [this](std::error_code ec, std::size_t length) {
                        if (!ec) {
                            auto msg_full_length = CalculateMsgFullLength(m_msgTemporaryIn);
                            if (msg_full_length > m_nHeaderSize) {
-                               m_msgTemporaryIn.body.resize(msg_full_length);
+                               if (size_t(msg_full_length) > m_msgTemporaryIn.body.capacity()) {
+                                   // Move the header into a pooled buffer large enough for the whole message
+                                   auto body = m_bufferPool.Acquire(msg_full_length);
+                                   std::memcpy(body.data(), m_msgTemporaryIn.body.data(), m_nHeaderSize);
+                                   m_bufferPool.Release(std::move(m_msgTemporaryIn.body));
+                                   m_msgTemporaryIn.body = std::move(body);
+                               } else {
+                                   m_msgTemporaryIn.body.resize(msg_full_length);
+                               }
                                ReadBody();
                            } else {
                                AddToIncomingMessageQueue();
@@ -212,13 +276,30 @@ namespace TCPConn {
                    });
     }
 
-    void TCPRawMsgSenderImpl::WriteRaw() {
-        async_write(m_socket, buffer(m_qMessagesOut.front().body.data(), m_qMessagesOut.front().full_size()),
+    void TCPRawMsgSenderImpl::WriteMessages() {
+        // Gather as many queued messages as the batch limits allow into one write
+        m_vecWriteBuffers.clear();
+        m_nMessagesWriting = 0;
+        size_t nBatchBytes = 0;
+        for (const auto& msg : m_qMessagesOut) {
+            if (m_nMessagesWriting > 0 &&
+                (nBatchBytes + msg.full_size() > m_config.max_write_batch_bytes ||
+                 m_vecWriteBuffers.size() >= m_config.max_write_batch_buffers))
+                break;
+            if (!msg.body.empty())
+                m_vecWriteBuffers.emplace_back(msg.body.data(), msg.body.size());
+            nBatchBytes += msg.full_size();
+            m_nMessagesWriting++;
+        }
+        async_write(m_socket, m_vecWriteBuffers,
                     [this](std::error_code ec, std::size_t length) {
                         if (!ec) {
-                            m_qMessagesOut.pop_front();
+                            m_qMessagesOut.erase(m_qMessagesOut.begin(), 
+                                                 m_qMessagesOut.begin() + std::ptrdiff_t(m_nMessagesWriting));
+                            m_limiter.Release(m_nMessagesWriting, length);
+                            NotifyWatermarks();
                             if (!m_qMessagesOut.empty()) {
-                                WriteRaw();
+                                WriteMessages();
                             }
                         } else {
                             INFO_MSG("Write raw message fail, closing connection.");
@@ -228,7 +309,8 @@ namespace TCPConn {
     }
 
     void TCPRawMsgSenderImpl::AddToIncomingMessageQueue() {
-        m_qMessagesIn.push_back(m_msgTemporaryIn);
+        if (m_config.capture) m_config.capture->Record(ECaptureDirection::inbound, 0, m_msgTemporaryIn);
+        m_qMessagesIn.push_back(std::move(m_msgTemporaryIn));
         if (m_eMsgType == ITCPRawMsgSender::ERawMsgType::no_header) ReadRaw();
         else ReadHeader();
     }
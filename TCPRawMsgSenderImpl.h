@@ -6,6 +6,12 @@
 #define TCPCONN_TCPRAWMSGSENDERIMPL_H
 
 #include "TCPRawMsgSender.h"
+#include "TCPBufferPool.h"
+#include "TCPOutgoingLimiter.h"
+#include "TCPSocketTuning.h"
+#include "TCPTransport.h"
+#include "TCPCapture.h"
+#include "TCPIoEngine.h"
 #include <boost/asio.hpp>
 #include <thread>
 
@@ -15,16 +21,18 @@ namespace TCPConn {
     
     class TCPRawMsgSenderImpl {
     public:
-        explicit TCPRawMsgSenderImpl(ITCPRawMsgSender& interface, ITCPRawMsgSender::ERawMsgType msg_type,
-                                     int header_size = 0, int length_offset = 0, int length_size = 0, 
+        TCPRawMsgSenderImpl(ITCPRawMsgSender& interface, ITCPRawMsgSender::ERawMsgType msg_type,
+                                     const TCPConnConfig& config, int header_size = 0, int length_offset = 0, int length_size = 0, 
                                      bool length_include_header = false, bool endian_flip = false);
         virtual ~TCPRawMsgSenderImpl();
         
         bool Connect(const std::string& host, uint16_t port);
         void Disconnect();
         [[nodiscard]] bool IsConnected() const;
+        [[nodiscard]] TCPSocketOptions GetSocketOptions() const;
         
         void Send(const TCPRawMsg& msg);
+        void Send(TCPRawMsg&& msg);
 
         void Update(size_t nMaxMessages = -1, bool bWait = true);
         void Run();
@@ -34,14 +42,23 @@ namespace TCPConn {
         void ReadRaw();
         void ReadHeader();
         void ReadBody();
-        void WriteRaw();
+        void WriteMessages();
+        void TrimOutgoingMessages();
+        void NotifyWatermarks();
         void AddToIncomingMessageQueue();
 
         io_context m_context;
-        ip::tcp::socket m_socket;
+        TCPStreamSocket m_socket;
         std::thread m_thrContext;
-        TCPMsgQueue<TCPRawMsg> m_qMessagesOut{};
-        TCPMsgQueue<TCPRawMsg> m_qMessagesIn{};
+        TCPConnConfig m_config;
+        // Only touched on the io thread, no locking needed
+        std::deque<TCPRawMsg> m_qMessagesOut{};
+        std::vector<const_buffer> m_vecWriteBuffers;
+        size_t m_nMessagesWriting = 0;
+        TCPOutgoingLimiter m_limiter;
+        bool m_bQuickAck = false;  // re-arm TCP_QUICKACK before every read
+        TCPMsgQueue<TCPRawMsg> m_qMessagesIn;
+        TCPBufferPool m_bufferPool;
         TCPRawMsg m_msgTemporaryIn;
         ITCPRawMsgSender::ERawMsgType m_eMsgType;
         
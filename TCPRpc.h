@@ -0,0 +1,137 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPRPC_H
+#define TCPCONN_TCPRPC_H
+
+#include "TCPServer.h"
+#include "TCPClient.h"
+#include <chrono>
+#include <future>
+#include <system_error>
+
+namespace TCPConn {
+
+    /// \brief Bit set in `TCPMsgHeader::type` of request and reply frames, the remaining bits carry the request type.
+    /// Frames without it are plain messages and reach `OnMessage` unchanged.
+    inline constexpr uint32_t TCPRPC_TYPE_FLAG = 0x80000000u;
+
+    /// \brief Kind of an RPC frame.
+    enum class ERpcStatus : uint32_t {
+        request,
+        reply,
+        no_handler,     ///< reply to a request type without a registered handler
+        handler_failed  ///< reply to a request whose handler threw
+    };
+
+    /// \brief Trailer appended to the body of every RPC frame, popped before the payload is handed over.
+    struct TCPRpcTrailer {
+        uint64_t id;                ///< correlation ID chosen by the caller, echoed in the reply
+        ERpcStatus status;
+        uint32_t reserved{};
+    };
+
+    /// \brief Errors completing a call.
+    enum class ERpcError {
+        timed_out = 1,
+        not_connected,
+        no_handler,
+        handler_failed
+    };
+
+    TCPCONN_API const std::error_category& RpcErrorCategory();
+
+    inline std::error_code make_error_code(ERpcError e) {
+        return {int(e), RpcErrorCategory()};
+    }
+
+    template <typename T>
+    class TCPRpcClientImpl;
+
+    template <typename T>
+    class TCPRpcServerImpl;
+
+    /// \brief Client issuing requests to an `ITCPRpcServer`, any number of them in flight at a time.
+    /// Replies are matched on the io thread, so calls complete without `Update()`; plain messages
+    /// still go through the incoming queue to `OnMessage`.
+    template <typename T>
+    class TCPCONN_API ITCPRpcClient : public ITCPClient<T> {
+    public:
+        ITCPRpcClient();
+
+        /// \brief Construct a client with custom connection tunables.
+        /// \param config tunables applied to the server connection
+        explicit ITCPRpcClient(const TCPConnConfig& config);
+        ~ITCPRpcClient() override;
+
+        /// \brief Send a request and get a future of its reply.
+        /// The future throws `std::system_error` with an `ERpcError` when the call fails, or with
+        /// `std::errc::connection_aborted` when the connection drops before the reply.
+        /// \param request request, `header.type` selects the handler on the server
+        /// \param timeout time to wait for the reply
+        /// \return future reply, its type is the type of the request
+        std::future<T> Call(T request, std::chrono::milliseconds timeout);
+
+        /// \brief Send a request and await its reply, resumed on the io thread or the timeout thread.
+        /// \param request request, `header.type` selects the handler on the server
+        /// \param timeout time to wait for the reply
+        /// \return awaitable reply
+        TCPAsync<T> CallAsync(T request, std::chrono::milliseconds timeout);
+
+        /// \brief Get the number of calls awaiting a reply.
+        [[nodiscard]] size_t PendingCalls() const;
+
+        /// \brief On a plain message received, does nothing by default.
+        /// \param msg received message
+        void OnMessage(T& msg) override {}
+
+    protected:
+        bool OnMessageIntercept(T& msg) override;
+        void OnConnectionClosed() override;
+
+    private:
+        std::unique_ptr<TCPRpcClientImpl<T>> pimpl;
+    };
+
+    /// \brief Server answering requests with handlers registered per request type.
+    /// Handlers run where `OnMessage` would, on the `Update()` thread or on the dispatch threads.
+    template <typename T>
+    class TCPCONN_API ITCPRpcServer : public ITCPServer<T> {
+    public:
+        /// \brief Produces the reply to a request, its type is set to the type of the request.
+        using Handler = std::function<T(std::shared_ptr<ITCPConn<T>> client, T& request)>;
+
+        /// \brief Construct a new ITCPRpcServer.
+        /// \param port port to accept connections on
+        /// \param config tunables applied to every accepted connection
+        explicit ITCPRpcServer(uint16_t port, const TCPConnConfig& config = {});
+
+        /// \brief Construct a new ITCPRpcServer listening on an address, see `ITCPServer`.
+        /// \param address `unix:/path/to.sock`, `unix:@name`, `shm:` and a Unix domain socket address, `host:port` or `:port`
+        /// \param config tunables applied to every accepted connection
+        explicit ITCPRpcServer(const std::string& address, const TCPConnConfig& config = {});
+        ~ITCPRpcServer() override;
+
+        /// \brief Register the handler of a request type, must be called before `Start()`.
+        /// \param nType request type, without `TCPRPC_TYPE_FLAG`
+        /// \param handler handler replacing any previous one of this type
+        void Handle(uint32_t nType, Handler handler);
+
+        /// \brief On a plain message received, does nothing by default.
+        /// \param client socket pointer to the client that sent the message
+        /// \param msg received message
+        virtual void OnPlainMessage(std::shared_ptr<ITCPConn<T>> client, T& msg) {}
+
+        void OnMessage(std::shared_ptr<ITCPConn<T>> client, T& msg) override;
+
+    private:
+        std::unique_ptr<TCPRpcServerImpl<T>> pimpl;
+    };
+
+} // TCPConn
+
+template <>
+struct std::is_error_code_enum<TCPConn::ERpcError> : std::true_type {};
+
+#endif //TCPCONN_TCPRPC_H
@@ -0,0 +1,286 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#include "TCPRpcImpl.h"
+#include "LogMacros.h"
+
+namespace TCPConn {
+
+    class TCPRpcErrorCategory : public std::error_category {
+    public:
+        [[nodiscard]] const char* name() const noexcept override {
+            return "tcpconn.rpc";
+        }
+
+        [[nodiscard]] std::string message(int nError) const override {
+            switch (ERpcError(nError)) {
+                case ERpcError::timed_out: return "RPC call timed out";
+                case ERpcError::not_connected: return "RPC client not connected";
+                case ERpcError::no_handler: return "No RPC handler for the request type";
+                case ERpcError::handler_failed: return "RPC handler failed";
+            }
+            return "Unknown RPC error";
+        }
+    };
+
+    const std::error_category& RpcErrorCategory() {
+        static TCPRpcErrorCategory category;
+        return category;
+    }
+
+    /* ----- ITCPRpcClient ----- */
+
+    template <typename T>
+    ITCPRpcClient<T>::ITCPRpcClient() {
+        pimpl = std::make_unique<TCPRpcClientImpl<T>>(*this);
+    }
+
+    template <typename T>
+    ITCPRpcClient<T>::ITCPRpcClient(const TCPConnConfig& config) : ITCPClient<T>(config) {
+        pimpl = std::make_unique<TCPRpcClientImpl<T>>(*this);
+    }
+
+    template <typename T>
+    ITCPRpcClient<T>::~ITCPRpcClient() {
+        // Stop the io thread first, it completes calls through pimpl
+        this->Disconnect();
+    }
+
+    template <typename T>
+    std::future<T> ITCPRpcClient<T>::Call(T request, std::chrono::milliseconds timeout) {
+        auto pPromise = std::make_shared<std::promise<T>>();
+        auto future = pPromise->get_future();
+        pimpl->Call(std::move(request), timeout, [pPromise](std::error_code ec, T&& reply) {
+            if (ec) pPromise->set_exception(std::make_exception_ptr(std::system_error(ec)));
+            else pPromise->set_value(std::move(reply));
+        });
+        return future;
+    }
+
+    template <typename T>
+    TCPAsync<T> ITCPRpcClient<T>::CallAsync(T request, std::chrono::milliseconds timeout) {
+        auto pState = std::make_shared<TCPAsyncState<T>>();
+        pimpl->Call(std::move(request), timeout, [pState](std::error_code ec, T&& reply) {
+            if (ec) pState->Fail(ec);
+            else pState->Complete(std::move(reply));
+        });
+        return TCPAsync<T>(std::move(pState));
+    }
+
+    template <typename T>
+    size_t ITCPRpcClient<T>::PendingCalls() const {
+        return pimpl->PendingCalls();
+    }
+
+    template <typename T>
+    bool ITCPRpcClient<T>::OnMessageIntercept(T& msg) {
+        return pimpl->CompleteCall(msg);
+    }
+
+    template <typename T>
+    void ITCPRpcClient<T>::OnConnectionClosed() {
+        pimpl->FailCalls(std::make_error_code(std::errc::connection_aborted));
+    }
+
+
+    /* ----- TCPRpcClientImpl ----- */
+
+    template <typename T>
+    TCPRpcClientImpl<T>::TCPRpcClientImpl(ITCPRpcClient<T>& interface) : _interface(interface) {
+        static_assert(std::is_same<T, TCPMsg>::value, "RPC frames need the TCPMsg header.");
+        m_thrTimeout = std::thread([this]() { ExpireCalls(); });
+    }
+
+    template <typename T>
+    TCPRpcClientImpl<T>::~TCPRpcClientImpl() {
+        std::unordered_map<uint64_t, PendingCall> mapPending;
+        {
+            std::scoped_lock lock(m_mtxPending);
+            m_bStopping = true;
+            mapPending.swap(m_mapPending);
+            m_mapDeadlines.clear();
+        }
+        m_cvPending.notify_one();
+        if (m_thrTimeout.joinable()) m_thrTimeout.join();
+        for (auto& [nID, call] : mapPending) call.fnComplete(ERpcError::not_connected, T{});
+    }
+
+    template <typename T>
+    void TCPRpcClientImpl<T>::Call(T&& request, std::chrono::milliseconds timeout, Completion fnComplete) {
+        if (!_interface.IsConnected()) {
+            fnComplete(ERpcError::not_connected, T{});
+            return;
+        }
+        uint64_t nID;
+        {
+            // Registered before sending, the reply may arrive before Send() returns
+            std::scoped_lock lock(m_mtxPending);
+            nID = m_nNextID++;
+            auto itDeadline = m_mapDeadlines.emplace(Clock::now() + timeout, nID);
+            m_mapPending.emplace(nID, PendingCall{std::move(fnComplete), itDeadline});
+            if (itDeadline == m_mapDeadlines.begin()) m_cvPending.notify_one();
+        }
+        request.header.type |= TCPRPC_TYPE_FLAG;
+        request << TCPRpcTrailer{nID, ERpcStatus::request};
+        _interface.Send(std::move(request));
+        // The connection may have closed since the check above, after its pending calls were failed
+        if (!_interface.IsConnected()) FailCalls(std::make_error_code(std::errc::connection_aborted));
+    }
+
+    template <typename T>
+    bool TCPRpcClientImpl<T>::CompleteCall(T& msg) {
+        if (!(msg.header.type & TCPRPC_TYPE_FLAG) || msg.body.size() < sizeof(TCPRpcTrailer)) return false;
+        TCPRpcTrailer trailer{};
+        std::memcpy(&trailer, msg.body.data() + msg.body.size() - sizeof(TCPRpcTrailer), sizeof(TCPRpcTrailer));
+        if (trailer.status == ERpcStatus::request) return false;
+        msg >> trailer;
+        msg.header.type &= ~TCPRPC_TYPE_FLAG;
+
+        Completion fnComplete;
+        {
+            std::scoped_lock lock(m_mtxPending);
+            auto it = m_mapPending.find(trailer.id);
+            if (it == m_mapPending.end()) return true;  // late reply of an expired call
+            fnComplete = std::move(it->second.fnComplete);
+            m_mapDeadlines.erase(it->second.itDeadline);
+            m_mapPending.erase(it);
+        }
+        switch (trailer.status) {
+            case ERpcStatus::no_handler:
+                fnComplete(ERpcError::no_handler, T{});
+                break;
+            case ERpcStatus::handler_failed:
+                fnComplete(ERpcError::handler_failed, T{});
+                break;
+            default:
+                fnComplete({}, std::move(msg));
+        }
+        return true;
+    }
+
+    template <typename T>
+    void TCPRpcClientImpl<T>::FailCalls(std::error_code ec) {
+        std::unordered_map<uint64_t, PendingCall> mapPending;
+        {
+            std::scoped_lock lock(m_mtxPending);
+            mapPending.swap(m_mapPending);
+            m_mapDeadlines.clear();
+        }
+        for (auto& [nID, call] : mapPending) call.fnComplete(ec, T{});
+    }
+
+    template <typename T>
+    size_t TCPRpcClientImpl<T>::PendingCalls() const {
+        std::scoped_lock lock(m_mtxPending);
+        return m_mapPending.size();
+    }
+
+    template <typename T>
+    void TCPRpcClientImpl<T>::ExpireCalls() {
+        std::vector<Completion> vecExpired;
+        std::unique_lock<std::mutex> ul(m_mtxPending);
+        while (!m_bStopping) {
+            if (m_mapDeadlines.empty()) {
+                m_cvPending.wait(ul);
+                continue;
+            }
+            auto tNow = Clock::now();
+            if (tNow < m_mapDeadlines.begin()->first) {
+                m_cvPending.wait_until(ul, m_mapDeadlines.begin()->first);
+                continue;
+            }
+            while (!m_mapDeadlines.empty() && m_mapDeadlines.begin()->first <= tNow) {
+                auto it = m_mapPending.find(m_mapDeadlines.begin()->second);
+                vecExpired.push_back(std::move(it->second.fnComplete));
+                m_mapPending.erase(it);
+                m_mapDeadlines.erase(m_mapDeadlines.begin());
+            }
+            ul.unlock();
+            for (auto& fnComplete : vecExpired) fnComplete(ERpcError::timed_out, T{});
+            vecExpired.clear();
+            ul.lock();
+        }
+    }
+
+
+    /* ----- ITCPRpcServer ----- */
+
+    template <typename T>
+    ITCPRpcServer<T>::ITCPRpcServer(uint16_t port, const TCPConnConfig& config) : ITCPServer<T>(port, config) {
+        pimpl = std::make_unique<TCPRpcServerImpl<T>>(*this);
+    }
+
+    template <typename T>
+    ITCPRpcServer<T>::ITCPRpcServer(const std::string& address, const TCPConnConfig& config)
+            : ITCPServer<T>(address, config) {
+        pimpl = std::make_unique<TCPRpcServerImpl<T>>(*this);
+    }
+
+    template <typename T>
+    ITCPRpcServer<T>::~ITCPRpcServer() {
+        // Handlers may still run on the dispatch threads until the server stops
+        this->Stop();
+    }
+
+    template <typename T>
+    void ITCPRpcServer<T>::Handle(uint32_t nType, Handler handler) {
+        pimpl->Handle(nType, std::move(handler));
+    }
+
+    template <typename T>
+    void ITCPRpcServer<T>::OnMessage(std::shared_ptr<ITCPConn<T>> client, T& msg) {
+        pimpl->OnMessage(std::move(client), msg);
+    }
+
+
+    /* ----- TCPRpcServerImpl ----- */
+
+    template <typename T>
+    TCPRpcServerImpl<T>::TCPRpcServerImpl(ITCPRpcServer<T>& interface) : _interface(interface) {
+        static_assert(std::is_same<T, TCPMsg>::value, "RPC frames need the TCPMsg header.");
+    }
+
+    template <typename T>
+    TCPRpcServerImpl<T>::~TCPRpcServerImpl() = default;
+
+    template <typename T>
+    void TCPRpcServerImpl<T>::Handle(uint32_t nType, typename ITCPRpcServer<T>::Handler handler) {
+        m_mapHandlers[nType & ~TCPRPC_TYPE_FLAG] = std::move(handler);
+    }
+
+    template <typename T>
+    void TCPRpcServerImpl<T>::OnMessage(std::shared_ptr<ITCPConn<T>> client, T& msg) {
+        if (!(msg.header.type & TCPRPC_TYPE_FLAG) || msg.body.size() < sizeof(TCPRpcTrailer)) {
+            _interface.OnPlainMessage(std::move(client), msg);
+            return;
+        }
+        TCPRpcTrailer trailer{};
+        msg >> trailer;
+        if (trailer.status != ERpcStatus::request) return;
+        uint32_t nType = msg.header.type & ~TCPRPC_TYPE_FLAG;
+        msg.header.type = nType;
+
+        T reply;
+        ERpcStatus status = ERpcStatus::reply;
+        auto it = m_mapHandlers.find(nType);
+        if (it == m_mapHandlers.end()) {
+            status = ERpcStatus::no_handler;
+        } else {
+            try {
+                reply = it->second(client, msg);
+            } catch (std::exception& e) {
+                ERROR_MSG("[SERVER] RPC handler of type {} failed: {}", nType, e.what());
+                reply = T{};
+                status = ERpcStatus::handler_failed;
+            }
+        }
+        reply.header.type = nType | TCPRPC_TYPE_FLAG;
+        reply << TCPRpcTrailer{trailer.id, status};
+        _interface.MessageClient(client, std::move(reply));
+    }
+
+    template class ITCPRpcClient<TCPMsg>;
+    template class ITCPRpcServer<TCPMsg>;
+
+} // TCPConn
@@ -0,0 +1,71 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPRPCIMPL_H
+#define TCPCONN_TCPRPCIMPL_H
+
+#include "TCPRpc.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace TCPConn {
+
+    template <typename T>
+    class TCPRpcClientImpl {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Completion = std::function<void(std::error_code ec, T&& reply)>;
+
+        explicit TCPRpcClientImpl(ITCPRpcClient<T>& interface);
+        virtual ~TCPRpcClientImpl();
+
+        void Call(T&& request, std::chrono::milliseconds timeout, Completion fnComplete);
+        bool CompleteCall(T& msg);
+        // Complete every pending call with ec at once
+        void FailCalls(std::error_code ec);
+        [[nodiscard]] size_t PendingCalls() const;
+
+    protected:
+        void ExpireCalls();
+
+        struct PendingCall {
+            Completion fnComplete;
+            std::multimap<Clock::time_point, uint64_t>::iterator itDeadline;
+        };
+
+        mutable std::mutex m_mtxPending;
+        std::condition_variable m_cvPending;
+        std::unordered_map<uint64_t, PendingCall> m_mapPending;
+        std::multimap<Clock::time_point, uint64_t> m_mapDeadlines;
+        uint64_t m_nNextID = 1;
+        bool m_bStopping = false;
+        std::thread m_thrTimeout;
+
+    private:
+        ITCPRpcClient<T>& _interface;
+    };
+
+    template <typename T>
+    class TCPRpcServerImpl {
+    public:
+        explicit TCPRpcServerImpl(ITCPRpcServer<T>& interface);
+        virtual ~TCPRpcServerImpl();
+
+        void Handle(uint32_t nType, typename ITCPRpcServer<T>::Handler handler);
+        void OnMessage(std::shared_ptr<ITCPConn<T>> client, T& msg);
+
+    protected:
+        // Filled before Start(), read concurrently afterwards
+        std::unordered_map<uint32_t, typename ITCPRpcServer<T>::Handler> m_mapHandlers;
+
+    private:
+        ITCPRpcServer<T>& _interface;
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPRPCIMPL_H
@@ -6,6 +6,7 @@
 #define TCPCONN_TCPSERVER_H
 
 #include "TCPConn.h"
+#include <span>
 
 namespace TCPConn {
 
@@ -17,8 +18,15 @@ namespace TCPConn {
     public:
 
         /// \brief Construct a new ITCPServer.
-        /// \param port 
-        explicit ITCPServer(uint16_t port);
+        /// \param port port to accept connections on
+        /// \param config tunables applied to every accepted connection
+        explicit ITCPServer(uint16_t port, const TCPConnConfig& config = {});
+
+        /// \brief Construct a new ITCPServer listening on an address.
+        /// \param address `unix:/path/to.sock`, `unix:@name` (Linux abstract namespace), `host:port` or `:port`.
+        /// `shm:` followed by a Unix domain socket address moves the frames of `TCPMsg` clients to shared memory
+        /// \param config tunables applied to every accepted connection
+        explicit ITCPServer(const std::string& address, const TCPConnConfig& config = {});
         virtual ~ITCPServer();
         
         
@@ -26,29 +34,62 @@ namespace TCPConn {
         /// \return true if server started successfully
         bool Start();
         
-        /// \brief Stop the server.
+        /// \brief Stop the server and close its client connections.
+        /// Coroutines awaiting a client fail with `std::errc::operation_canceled` on the io thread of that client.
         void Stop();
+
+        /// \brief Await the next approved client, for an accept loop written as a coroutine.
+        /// From the first call on, approved clients are queued for `Accept()` and their messages are
+        /// delivered to `ITCPConn::Receive()` instead of `OnMessage`. Only one accept may be pending at a time,
+        /// fails with `std::errc::operation_canceled` when the server stops.
+        /// \return awaitable socket pointer to the client, its validation may still be in progress
+        TCPAsync<std::shared_ptr<ITCPConn<T>>> Accept();
         
         
         /// \brief Message a client.
         /// \param client socket pointer to the client
         /// \param msg message to send
         void MessageClient(std::shared_ptr<ITCPConn<T>> client, const T& msg) const;
+
+        /// \brief Message a client, the message body is moved rather than copied.
+        /// \param client socket pointer to the client
+        /// \param msg message to send
+        void MessageClient(std::shared_ptr<ITCPConn<T>> client, T&& msg) const;
+        
+        /// \brief Message a client by its ID, nothing is sent if no client has this ID.
+        /// \param nClientID ID of the client, see `ITCPConn::GetID`
+        /// \param msg message to send
+        void MessageClient(uint64_t nClientID, const T& msg) const;
+
+        /// \brief Message a client by its ID, the message body is moved rather than copied.
+        /// \param nClientID ID of the client, see `ITCPConn::GetID`
+        /// \param msg message to send
+        void MessageClient(uint64_t nClientID, T&& msg) const;
         
         /// \brief Message all clients.
         /// \param msg message to send
         /// \param pIgnoreClient socket pointer to the client to ignore
         void MessageAllClients(const T& msg, std::shared_ptr<ITCPConn<T>> pIgnoreClient = nullptr) const;
+
+        /// \brief Message all clients with a shared message, every client references the same payload.
+        /// \param msg message to send, must not be modified afterwards
+        /// \param pIgnoreClient socket pointer to the client to ignore
+        void MessageAllClients(const TCPMsgShared<T>& msg, std::shared_ptr<ITCPConn<T>> pIgnoreClient = nullptr) const;
         
         
         /// \brief Actively consume messages in the message queue.
         /// \param nMaxMessages maximum number of messages to consume, default is -1, consume all
         /// \param bWait whether to block to wait for incoming messages, must be true if used in a loop
+        /// \throw whatever a handler threw, also one thrown on a dispatch thread since the previous call
         void Update(bool bWait, size_t nMaxMessages = -1);
         
         /// \brief Start continuous update messages.
         /// Will block the current thread. Pending signals to terminate.
         void Run();
+
+        /// \brief Get a snapshot of the runtime metrics, safe to call from any thread.
+        /// \return connection counts and the totals of all connections
+        [[nodiscard]] TCPServerStats GetStats() const;
         
         
         /// \brief On new connection request, pending approval to establish connection.
@@ -64,11 +105,31 @@ namespace TCPConn {
         /// \param client socket pointer to the disconnected client
         virtual void OnClientDisconnected(std::shared_ptr<ITCPConn<T>> client) {}
         
+        /// \brief On the outgoing queue of a client reaching `TCPConnConfig::outgoing_high_watermark_bytes`.
+        /// Called on the io thread of the client, producers should hold back messages to it.
+        /// \param client socket pointer to the congested client
+        virtual void OnBackpressure(std::shared_ptr<ITCPConn<T>> client) {}
+
+        /// \brief On the outgoing queue of a client draining to `TCPConnConfig::outgoing_low_watermark_bytes`.
+        /// Called on the io thread of the client after `OnBackpressure`.
+        /// \param client socket pointer to the client
+        virtual void OnWritable(std::shared_ptr<ITCPConn<T>> client) {}
+        
         /// \brief On message received, must be overridden.
         /// \param client socket pointer to the client that sent the message
         /// \param msg received message
         virtual void OnMessage(std::shared_ptr<ITCPConn<T>> client, T& msg) = 0;
 
+        /// \brief On a batch of messages drained by one `Update()`, in arrival order.
+        /// With `TCPConnConfig::dispatch_threads` set, a batch holds the messages of a single client and
+        /// batches of different clients are handled concurrently on the dispatch threads.
+        /// Override to process the batch at once, by default each message is passed to `OnMessage`.
+        /// Message bodies are recycled once this returns, move them out to keep them.
+        /// \param msgs received messages together with the client that sent each
+        virtual void OnMessageBatch(std::span<TCPMsgOwned<T>> msgs) {
+            for (auto& msg : msgs) OnMessage(msg.remote, msg.msg);
+        }
+
     private:
         std::unique_ptr<TCPServerImpl<T>> pimpl;
     };
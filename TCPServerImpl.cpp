@@ -14,9 +14,15 @@ namespace TCPConn {
     /* ----- ITCPServer ----- */
 
     template <typename T>
-    ITCPServer<T>::ITCPServer(uint16_t port) 
+    ITCPServer<T>::ITCPServer(uint16_t port, const TCPConnConfig& config) 
     {
-        pimpl = std::make_unique<TCPServerImpl<T>>(*this, port);
+        pimpl = std::make_unique<TCPServerImpl<T>>(*this, ":" + std::to_string(port), config);
+    }
+
+    template <typename T>
+    ITCPServer<T>::ITCPServer(const std::string& address, const TCPConnConfig& config)
+    {
+        pimpl = std::make_unique<TCPServerImpl<T>>(*this, address, config);
     }
 
     template <typename T>
@@ -32,16 +38,41 @@ namespace TCPConn {
         pimpl->Stop();
     }
 
+    template <typename T>
+    TCPAsync<std::shared_ptr<ITCPConn<T>>> ITCPServer<T>::Accept() {
+        return pimpl->Accept();
+    }
+
     template <typename T>
     void ITCPServer<T>::MessageClient(std::shared_ptr<ITCPConn<T>> client, const T& msg) const {
         pimpl->MessageClient(client, msg);
     }
 
+    template <typename T>
+    void ITCPServer<T>::MessageClient(std::shared_ptr<ITCPConn<T>> client, T&& msg) const {
+        pimpl->MessageClient(client, std::move(msg));
+    }
+
+    template <typename T>
+    void ITCPServer<T>::MessageClient(uint64_t nClientID, const T& msg) const {
+        pimpl->MessageClient(nClientID, T(msg));
+    }
+
+    template <typename T>
+    void ITCPServer<T>::MessageClient(uint64_t nClientID, T&& msg) const {
+        pimpl->MessageClient(nClientID, std::move(msg));
+    }
+
     template <typename T>
     void ITCPServer<T>::MessageAllClients(const T& msg, std::shared_ptr<ITCPConn<T>> pIgnoreClient) const {
         pimpl->MessageAllClients(msg, pIgnoreClient);
     }
 
+    template <typename T>
+    void ITCPServer<T>::MessageAllClients(const TCPMsgShared<T>& msg, std::shared_ptr<ITCPConn<T>> pIgnoreClient) const {
+        pimpl->MessageAllClients(msg, pIgnoreClient);
+    }
+
     template <typename T>
     void ITCPServer<T>::Update(bool bWait, size_t nMaxMessages) {
         pimpl->Update(bWait, nMaxMessages);
@@ -52,6 +83,11 @@ namespace TCPConn {
         pimpl->Run();
     }
 
+    template <typename T>
+    TCPServerStats ITCPServer<T>::GetStats() const {
+        return pimpl->GetStats();
+    }
+
 
     /* ----- TCPServerImpl ----- */
 
@@ -59,13 +95,33 @@ namespace TCPConn {
     std::atomic<bool> TCPServerImpl<T>::m_bShuttingDown = false;
     
     template <typename T>
-    TCPServerImpl<T>::TCPServerImpl(ITCPServer<T>& interface, uint16_t port)
-            : _interface(interface), m_port(port), m_acceptor(m_context, ip::tcp::endpoint(ip::tcp::v4(), port)) {
+    TCPServerImpl<T>::TCPServerImpl(ITCPServer<T>& interface, const std::string& address, const TCPConnConfig& config)
+            : _interface(interface), m_context(IoContextHint()), m_strAddress(address), m_config(config),
+              m_qMessagesIn(config.incoming_queue_mode, config.incoming_queue_capacity),
+              m_bufferPool(config.receive_pool_buffers_per_class),
+              m_acceptor(m_context) {
+        TCPStreamEndpoint endpoint = MakeListenEndpoint(address);
+        m_acceptor.open(endpoint.protocol());
+        if (IsUnixEndpoint(endpoint)) RemoveUnixSocketFile(endpoint);
+        else m_acceptor.set_option(socket_base::reuse_address(true));
+        ApplyListenOptions(m_acceptor, config.socket_options);
+        m_acceptor.bind(endpoint);
+        m_acceptor.listen();
+        if constexpr (TCPCONN_IO_URING_ENABLED && std::is_same<T, TCPMsg>::value) {
+            if (config.read_mode == EReadMode::buffered && config.registered_read_buffers > 0)
+                m_pReadSlab = std::make_shared<TCPReadBufferSlab>(m_context, config.registered_read_buffers,
+                        std::max(config.read_buffer_size, 2 * sizeof(TCPMsgHeader)));
+        }
+        if (config.dispatch_threads > 0)
+            m_pDispatchPool = std::make_unique<TCPDispatchPool<T>>(config.dispatch_threads,
+                    [this](std::vector<TCPMsgOwned<T>>& vecBatch) { Dispatch(vecBatch); });
     }
 
     template <typename T>
     TCPServerImpl<T>::~TCPServerImpl() {
         Stop();
+        if (m_pReadSlab) m_pReadSlab->Unregister();
+        if (m_acceptor.is_open()) RemoveUnixSocketFile(m_acceptor.local_endpoint());
         INFO_MSG("[SERVER] Terminated cleanly.");
     }
 
@@ -73,39 +129,81 @@ namespace TCPConn {
     bool TCPServerImpl<T>::Start() {
         try {
             WaitForClientConnection();
-            m_thrContext = std::thread([this]() { m_context.run(); });
+            for (size_t i = 0; i < std::max<size_t>(m_config.io_threads, 1); i++)
+                m_vecThrContext.emplace_back([this]() { m_context.run(); });
         }
         catch (std::exception& e) {
             ERROR_MSG("[SERVER] Exception: {}", e.what());
             return false;
         }
-        INFO_MSG("[SERVER] Accepting connect at :{}.", m_port);
+        INFO_MSG("[SERVER] Accepting connect at {} with {} io thread(s) on {}.", m_strAddress, m_vecThrContext.size(), GetIoEngine());
         return true;
     }
 
     template <typename T>
     void TCPServerImpl<T>::Stop() {
         m_qMessagesIn.exit_wait();
+        // Without io threads nothing would run the posted closes, a stopped context has them done in place
+        if (m_vecThrContext.empty()) m_context.stop();
+        // Connections close on their io threads, so coroutines awaiting a client resume there
+        std::vector<std::shared_ptr<ITCPConn<T>>> vecClients;
+        {
+            std::scoped_lock lock(m_mtxConns);
+            vecClients.assign(m_conns.begin(), m_conns.end());
+        }
+        std::vector<std::future<void>> vecClosed;
+        for (auto& client : vecClients)
+            vecClosed.push_back(client->pimpl->CloseOnIoThread(std::make_error_code(std::errc::operation_canceled)));
+        for (auto& closed : vecClosed) closed.wait();
         m_context.stop();
-        if (m_thrContext.joinable()) m_thrContext.join();
+        for (auto& thr : m_vecThrContext)
+            if (thr.joinable()) thr.join();
+        m_vecThrContext.clear();
+        if (m_pDispatchPool) m_pDispatchPool->Stop();
+        
+        // Accept() is completed under m_mtxAccept rather than on an io thread, a pending one is cancelled here
+        std::shared_ptr<TCPAsyncState<std::shared_ptr<ITCPConn<T>>>> pWaiter;
+        {
+            std::scoped_lock lock(m_mtxAccept);
+            pWaiter = std::move(m_pAcceptWaiter);
+        }
+        if (pWaiter) pWaiter->Fail(std::make_error_code(std::errc::operation_canceled));
+    }
+
+    template <typename T>
+    TCPAsync<std::shared_ptr<ITCPConn<T>>> TCPServerImpl<T>::Accept() {
+        auto pState = std::make_shared<TCPAsyncState<std::shared_ptr<ITCPConn<T>>>>();
+        std::shared_ptr<ITCPConn<T>> client;
+        bool bBusy = false;
+        {
+            std::scoped_lock lock(m_mtxAccept);
+            m_bAcceptDirect = true;
+            if (!m_qAccepted.empty()) {
+                client = std::move(m_qAccepted.front());
+                m_qAccepted.pop_front();
+            } else if (m_pAcceptWaiter) {
+                bBusy = true;
+            } else {
+                m_pAcceptWaiter = pState;
+            }
+        }
+        if (client) pState->Complete(std::move(client));
+        else if (bBusy) pState->Fail(std::make_error_code(std::errc::operation_in_progress));
+        return TCPAsync<std::shared_ptr<ITCPConn<T>>>(std::move(pState));
     }
 
     template <typename T>
     void TCPServerImpl<T>::WaitForClientConnection() {
-        m_acceptor.async_accept(
-                [this](std::error_code ec, ip::tcp::socket socket) {
+        // Every accepted socket is bound to its own strand, so handlers of one connection
+        // never run concurrently even when several threads run the io_context.
+        m_acceptor.async_accept(make_strand(m_context),
+                [this](std::error_code ec, TCPStreamSocket socket) {
                     if (!ec) {
-                        INFO_MSG("[SERVER] New Connection: {}", socket.remote_endpoint().address().to_string());
-                        struct ITCPConn<T>::TCPContext tcp_context{ m_context, std::move(socket) };
-                        auto new_conn = std::make_shared<ITCPConn<T>>(ITCPConn<T>::EOwner::server, tcp_context, m_qMessagesIn);
-                        if (_interface.OnClientConnectionRequest(new_conn)) {
-                            m_deqConns.push_back(std::move(new_conn));
-                            m_deqConns.back()->ConnectToClient(m_idCounter++ % 100);  // TODO virtual function GenerateID()
-                            _interface.OnClientConnected(m_deqConns.back());
-                            INFO_MSG("[Client {:02}] Connection approved.", m_deqConns.back()->GetID());
-                        } 
-                        else
-                            INFO_MSG("[SERVER] Connection denied!");
+                        INFO_MSG("[SERVER] New Connection: {}", EndpointToString(socket.remote_endpoint()));
+                        auto strand = socket.get_executor();
+                        post(strand, [this, socket = std::move(socket)]() mutable {
+                            ApproveClientConnection(std::move(socket));
+                        });
                     } else {
                         ERROR_MSG("[SERVER] New connection error: {}", ec.message());
                     }
@@ -113,51 +211,135 @@ namespace TCPConn {
                 });
     }
 
+    template <typename T>
+    void TCPServerImpl<T>::ApproveClientConnection(TCPStreamSocket socket) {
+        // Runs on the strand of the new connection, so sends queued from the callbacks
+        // below are written only after the validation handshake has been started.
+        struct ITCPConn<T>::TCPContext tcp_context{ m_context, std::move(socket), m_bufferPool, m_pReadSlab,
+                                                    IsShmAddress(m_strAddress) };
+        auto new_conn = std::make_shared<ITCPConn<T>>(ITCPConn<T>::EOwner::server, tcp_context, 
+                                                     m_qMessagesIn, m_config);
+        std::weak_ptr<ITCPConn<T>> weak_conn = new_conn;
+        new_conn->SetWatermarkCallback([this, weak_conn](bool bBackpressure) {
+            if (auto client = weak_conn.lock()) {
+                if (bBackpressure) _interface.OnBackpressure(client);
+                else _interface.OnWritable(client);
+            }
+        });
+        if (_interface.OnClientConnectionRequest(new_conn)) {
+            uint64_t nID;
+            {
+                std::scoped_lock lock(m_mtxConns);
+                nID = m_conns.Insert(new_conn);
+            }
+            m_nConnectionsAccepted.fetch_add(1, std::memory_order_relaxed);
+            bool bAcceptDirect = m_bAcceptDirect;
+            if (bAcceptDirect) new_conn->pimpl->EnableReceive();
+            new_conn->ConnectToClient(nID);
+            _interface.OnClientConnected(new_conn);
+            INFO_MSG("[Client {:02}] Connection approved.", new_conn->GetID());
+            if (bAcceptDirect) {
+                std::shared_ptr<TCPAsyncState<std::shared_ptr<ITCPConn<T>>>> pWaiter;
+                {
+                    std::scoped_lock lock(m_mtxAccept);
+                    pWaiter = std::move(m_pAcceptWaiter);
+                    if (!pWaiter) m_qAccepted.push_back(new_conn);
+                }
+                // Resumes the accept loop right here on the strand of the new connection
+                if (pWaiter) pWaiter->Complete(new_conn);
+            }
+        } 
+        else {
+            m_nConnectionsDenied.fetch_add(1, std::memory_order_relaxed);
+            INFO_MSG("[SERVER] Connection denied!");
+        }
+    }
+
     template <typename T>
     void TCPServerImpl<T>::MessageClient(std::shared_ptr<ITCPConn<T>> client, const T& msg) {
+        MessageClient(client, T(msg));
+    }
+
+    template <typename T>
+    void TCPServerImpl<T>::MessageClient(std::shared_ptr<ITCPConn<T>> client, T&& msg) {
         if (client && client->IsConnected()) {
-            client->Send(msg);
+            client->Send(std::move(msg));
         } else if (client) {
+            {
+                std::scoped_lock lock(m_mtxConns);
+                if (m_conns.Find(client->GetID()) == client) {
+                    m_conns.Remove(client->GetID());
+                    RetireConnection(client);
+                }
+            }
             _interface.OnClientDisconnected(client);
-            client.reset();
-            m_deqConns.erase(
-                    std::remove(m_deqConns.begin(), m_deqConns.end(), client),
-                    m_deqConns.end());
         }
     }
 
+    template <typename T>
+    void TCPServerImpl<T>::MessageClient(uint64_t nClientID, T&& msg) {
+        std::shared_ptr<ITCPConn<T>> client;
+        {
+            std::scoped_lock lock(m_mtxConns);
+            client = m_conns.Find(nClientID);
+        }
+        if (client) MessageClient(client, std::move(msg));
+    }
+
     template <typename T>
     void TCPServerImpl<T>::MessageAllClients(const T& msg, std::shared_ptr<ITCPConn<T>> pIgnoreClient) {
+        // Copy the payload once, all outgoing queues reference the same buffer
+        MessageAllClients(std::make_shared<const T>(msg), pIgnoreClient);
+    }
+
+    template <typename T>
+    void TCPServerImpl<T>::MessageAllClients(const TCPMsgShared<T>& msg, std::shared_ptr<ITCPConn<T>> pIgnoreClient) {
         DEBUG_MSG("[SERVER] Sending message to all clients...");
-        bool bInvalidClientExists = false;
-        for (auto& client: m_deqConns) {
-            if (client && client->IsConnected()) {
-                if (client != pIgnoreClient) {
-                    client->Send(msg);
-                    DEBUG_MSG("[SERVER] Message sent to [Client {:02}]", client->GetID());
+        std::vector<std::shared_ptr<ITCPConn<T>>> vecTargets;
+        std::vector<std::shared_ptr<ITCPConn<T>>> vecDisconnected;
+        {
+            std::scoped_lock lock(m_mtxConns);
+            vecTargets.reserve(m_conns.size());
+            m_conns.EraseIf([&](const std::shared_ptr<ITCPConn<T>>& client) {
+                if (client->IsConnected()) {
+                    if (client != pIgnoreClient) vecTargets.push_back(client);
+                    return false;
                 }
-            } else if (client) {
-                _interface.OnClientDisconnected(client);
-                client.reset();
-                bInvalidClientExists = true;
-            }
+                RetireConnection(client);
+                vecDisconnected.push_back(client);
+                return true;
+            });
         }
-        if (bInvalidClientExists) {
-            m_deqConns.erase(
-                    std::remove(m_deqConns.begin(), m_deqConns.end(), nullptr),
-                    m_deqConns.end());
+        // Sends run without the lock held, EOverflowPolicy::block may wait for a slow client
+        // Connections that compress share one deflated copy of the payload
+        TCPDeflatedShare deflated;
+        for (auto& client: vecTargets) {
+            client->pimpl->Send(msg, nullptr, &deflated);
+            DEBUG_MSG("[SERVER] Message sent to [Client {:02}]", client->GetID());
         }
+        // Callbacks run without the lock held, they may message clients themselves
+        for (auto& client: vecDisconnected)
+            _interface.OnClientDisconnected(client);
     }
 
     template <typename T>
     void TCPServerImpl<T>::Update(bool bWait, size_t nMaxMessages) {
+        // Handlers that threw on the dispatch threads unwind out of Update() as they would without them
+        if (m_pDispatchPool) m_pDispatchPool->RethrowError();
         if (bWait) m_qMessagesIn.wait();
-        size_t nMessageCount = 0;
-        while (nMessageCount < nMaxMessages && !m_qMessagesIn.empty()) {
-            auto msg = m_qMessagesIn.pop_front();
-            _interface.OnMessage(msg.remote, msg.msg);
-            nMessageCount++;
-        }
+        // Reused across calls, Update() may run on several threads for locked queues
+        thread_local std::vector<TCPMsgOwned<T>> vecBatch;
+        if (m_qMessagesIn.try_pop_all(vecBatch, nMaxMessages) == 0) return;
+        if (m_pDispatchPool) m_pDispatchPool->Post(vecBatch);
+        else Dispatch(vecBatch);
+    }
+
+    template <typename T>
+    void TCPServerImpl<T>::Dispatch(std::vector<TCPMsgOwned<T>>& vecBatch) {
+        TCPBatchRelease release(vecBatch, m_bufferPool);
+        _interface.OnMessageBatch(std::span<TCPMsgOwned<T>>(vecBatch));
+        if constexpr (TCPCONN_STATS_ENABLED)
+            m_nMessagesDispatched.fetch_add(vecBatch.size(), std::memory_order_relaxed);
     }
 
     template<typename T>
@@ -182,6 +364,34 @@ namespace TCPConn {
     }
     
     
+    template <typename T>
+    TCPServerStats TCPServerImpl<T>::GetStats() {
+        TCPServerStats stats;
+        {
+            std::scoped_lock lock(m_mtxConns);
+            stats = m_statsRetired;
+            stats.connections_active = m_conns.size();
+            for (auto& client: m_conns) {
+                TCPConnStats conn = client->GetStats();
+                AccumulateStats(stats, conn);
+                stats.outgoing_queue_depth += conn.outgoing_queue_depth;
+            }
+        }
+        stats.connections_accepted = m_nConnectionsAccepted.load(std::memory_order_relaxed);
+        stats.connections_denied = m_nConnectionsDenied.load(std::memory_order_relaxed);
+        stats.messages_dispatched = m_nMessagesDispatched.load(std::memory_order_relaxed);
+        if constexpr (TCPCONN_STATS_ENABLED) stats.incoming_queue_depth = m_qMessagesIn.count();
+        return stats;
+    }
+
+    template <typename T>
+    void TCPServerImpl<T>::RetireConnection(const std::shared_ptr<ITCPConn<T>>& client) {
+        // m_mtxConns must be held, the totals of a dropped connection outlive it
+        AccumulateStats(m_statsRetired, client->GetStats());
+        if (m_pDispatchPool) m_pDispatchPool->Forget(client.get());
+    }
+    
+    
     template class ITCPServer<TCPMsg>;
     template class ITCPServer<TCPRawMsg>;
     
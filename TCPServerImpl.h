@@ -6,6 +6,12 @@
 #define TCPCONN_TCPSERVERIMPL_H
 
 #include "TCPServer.h"
+#include "TCPBufferPool.h"
+#include "TCPStatsRecorder.h"
+#include "TCPConnRegistry.h"
+#include "TCPDispatchPool.h"
+#include "TCPIoEngine.h"
+#include "TCPTransport.h"
 #include <boost/asio.hpp>
 
 using namespace boost::asio;
@@ -15,28 +21,54 @@ namespace TCPConn {
     template <typename T>
     class TCPServerImpl {
     public:
-        TCPServerImpl(ITCPServer<T>& interface, uint16_t port);
+        TCPServerImpl(ITCPServer<T>& interface, const std::string& address, const TCPConnConfig& config);
         virtual ~TCPServerImpl();
 
         bool Start();
         void Stop();
+        TCPAsync<std::shared_ptr<ITCPConn<T>>> Accept();
 
         void WaitForClientConnection();
+        void ApproveClientConnection(TCPStreamSocket socket);
 
         void MessageClient(std::shared_ptr<ITCPConn<T>> client, const T& msg);
+        void MessageClient(std::shared_ptr<ITCPConn<T>> client, T&& msg);
+        void MessageClient(uint64_t nClientID, T&& msg);
         void MessageAllClients(const T& msg, std::shared_ptr<ITCPConn<T>> pIgnoreClient = nullptr);
+        void MessageAllClients(const TCPMsgShared<T>& msg, std::shared_ptr<ITCPConn<T>> pIgnoreClient = nullptr);
 
         void Update(bool bWait, size_t nMaxMessages = -1);
         void Run();
+
+        TCPServerStats GetStats();
         
     protected:
-        TCPMsgQueue<TCPMsgOwned<T>> m_qMessagesIn;
-        std::deque<std::shared_ptr<ITCPConn<T>>> m_deqConns;
+        void RetireConnection(const std::shared_ptr<ITCPConn<T>>& client);
+        void Dispatch(std::vector<TCPMsgOwned<T>>& vecBatch);
+
+        // Declared first so that connections (also referenced by queued messages) are destroyed
+        // before the context their sockets and strands belong to.
         io_context m_context;
-        std::thread m_thrContext;
-        ip::tcp::acceptor m_acceptor;
-        uint16_t m_port;
-        uint32_t m_idCounter = 1;
+        TCPMsgQueue<TCPMsgOwned<T>> m_qMessagesIn;
+        TCPBufferPool m_bufferPool;
+        TCPConnRegistry<ITCPConn<T>> m_conns;
+        std::mutex m_mtxConns;
+        std::vector<std::thread> m_vecThrContext;
+        TCPStreamAcceptor m_acceptor;
+        std::string m_strAddress;
+        TCPConnConfig m_config;
+        std::atomic<uint64_t> m_nConnectionsAccepted{0};
+        std::atomic<uint64_t> m_nConnectionsDenied{0};
+        std::atomic<uint64_t> m_nMessagesDispatched{0};
+        TCPServerStats m_statsRetired;  // totals of dropped connections, guarded by m_mtxConns
+        std::unique_ptr<TCPDispatchPool<T>> m_pDispatchPool;   // null when handlers run on the Update() thread
+        std::shared_ptr<TCPReadBufferSlab> m_pReadSlab;        // null unless buffered reads run on io_uring
+        
+        // Clients handed to Accept() once it has been called, guarded by m_mtxAccept
+        std::mutex m_mtxAccept;
+        std::atomic<bool> m_bAcceptDirect{false};
+        std::deque<std::shared_ptr<ITCPConn<T>>> m_qAccepted;
+        std::shared_ptr<TCPAsyncState<std::shared_ptr<ITCPConn<T>>>> m_pAcceptWaiter;
         static std::atomic<bool> m_bShuttingDown;
         
     private:
@@ -0,0 +1,345 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPSHAREDMEMORY_H
+#define TCPCONN_TCPSHAREDMEMORY_H
+
+#include "LogMacros.h"
+#include <boost/asio.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#if defined __linux__
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace TCPConn {
+
+    // memfd segments and eventfd wakeups are Linux only, elsewhere `shm:` addresses stay on the Unix domain socket
+#if defined __linux__ && defined BOOST_ASIO_HAS_POSIX_STREAM_DESCRIPTOR
+#define TCPCONN_HAS_SHM
+    inline constexpr bool TCPCONN_SHM_ENABLED = true;
+#else
+    inline constexpr bool TCPCONN_SHM_ENABLED = false;
+#endif
+
+    /// \brief Hint to the core that the thread is busy waiting.
+    inline void CpuRelax() {
+#if defined __x86_64__ || defined __i386__
+        __builtin_ia32_pause();
+#elif defined __aarch64__
+        asm volatile("yield");
+#endif
+    }
+
+#ifdef TCPCONN_HAS_SHM
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "Rings shared between processes need address-free atomics.");
+
+    /// \brief Positions of one ring, at the start of its part of the segment.
+    /// Each flag sits on the cache line the side waking the sleeper writes anyway.
+    struct TCPShmRingControl {
+        alignas(64) std::atomic<uint64_t> head;             // bytes written, advanced by the producer
+        std::atomic<uint32_t> consumer_sleeping;            // consumer waits on the data eventfd
+        alignas(64) std::atomic<uint64_t> tail;             // bytes read, advanced by the consumer
+        std::atomic<uint32_t> producer_sleeping;            // producer waits on the space eventfd
+    };
+
+    /// \brief One side of a single producer, single consumer byte ring in shared memory.
+    /// Bytes are staged with `Write` or `Read` and handed to the other side by `Publish` or `Consume`,
+    /// which also wake it through its eventfd when it went to sleep.
+    class TCPShmRing {
+    public:
+        TCPShmRing() = default;
+
+        /// \param pControl positions shared with the other side
+        /// \param pData ring storage of `nSize` bytes, a power of two
+        /// \param nWakeFd eventfd the other side sleeps on
+        TCPShmRing(TCPShmRingControl* pControl, uint8_t* pData, size_t nSize, int nWakeFd)
+                : m_pControl(pControl), m_pData(pData), m_nMask(nSize - 1), m_nWakeFd(nWakeFd) {
+            m_nHead = pControl->head.load(std::memory_order_relaxed);
+            m_nTail = pControl->tail.load(std::memory_order_relaxed);
+        }
+
+        /* ----- producer ----- */
+
+        [[nodiscard]] size_t Writable() const {
+            return m_nMask + 1 - (m_nHead - m_pControl->tail.load(std::memory_order_acquire));
+        }
+
+        /// \brief Stage bytes after the unpublished ones, as many as the ring has room for.
+        /// \return number of bytes staged
+        size_t Write(const uint8_t* pSrc, size_t nSize) {
+            nSize = std::min(nSize, Writable());
+            if (nSize == 0) return 0;
+            size_t nPos = m_nHead & m_nMask;
+            size_t nFirst = std::min(nSize, m_nMask + 1 - nPos);
+            std::memcpy(m_pData + nPos, pSrc, nFirst);
+            std::memcpy(m_pData, pSrc + nFirst, nSize - nFirst);
+            m_nHead += nSize;
+            return nSize;
+        }
+
+        /// \brief Make the staged bytes visible and wake the consumer if it sleeps.
+        void Publish() {
+            if (m_pControl->head.load(std::memory_order_relaxed) == m_nHead) return;
+            m_pControl->head.store(m_nHead, std::memory_order_release);
+            // Pairs with the fence in PrepareReadWait(): either the consumer sees the bytes or we see it asleep
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            Wake(m_pControl->consumer_sleeping);
+        }
+
+        /// \brief Announce the producer is about to sleep on the space eventfd.
+        /// \return false if room appeared meanwhile and the producer should write instead
+        bool PrepareWriteWait() {
+            m_pControl->producer_sleeping.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (Writable() == 0) return true;
+            m_pControl->producer_sleeping.store(0, std::memory_order_relaxed);
+            return false;
+        }
+
+        /* ----- consumer ----- */
+
+        [[nodiscard]] size_t Readable() const {
+            return m_pControl->head.load(std::memory_order_acquire) - m_nTail;
+        }
+
+        /// \brief Copy out bytes after the ones already read, as many as are published.
+        /// \return number of bytes copied
+        size_t Read(uint8_t* pDst, size_t nSize) {
+            nSize = std::min(nSize, Readable());
+            if (nSize == 0) return 0;
+            size_t nPos = m_nTail & m_nMask;
+            size_t nFirst = std::min(nSize, m_nMask + 1 - nPos);
+            std::memcpy(pDst, m_pData + nPos, nFirst);
+            std::memcpy(pDst + nFirst, m_pData, nSize - nFirst);
+            m_nTail += nSize;
+            return nSize;
+        }
+
+        /// \brief Hand the bytes read back to the producer and wake it if it waits for room.
+        void Consume() {
+            if (m_pControl->tail.load(std::memory_order_relaxed) == m_nTail) return;
+            m_pControl->tail.store(m_nTail, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            Wake(m_pControl->producer_sleeping);
+        }
+
+        /// \brief Announce the consumer is about to sleep on the data eventfd.
+        /// \return false if data arrived meanwhile and the consumer should read instead
+        bool PrepareReadWait() {
+            m_pControl->consumer_sleeping.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (Readable() == 0) return true;
+            m_pControl->consumer_sleeping.store(0, std::memory_order_relaxed);
+            return false;
+        }
+
+    private:
+        friend class TCPShmChannel;
+        [[nodiscard]] int WakeFd() const { return m_nWakeFd; }
+
+        void Wake(std::atomic<uint32_t>& sleeping) const {
+            if (sleeping.load(std::memory_order_relaxed) && sleeping.exchange(0, std::memory_order_relaxed))
+                eventfd_write(m_nWakeFd, 1);
+        }
+
+        TCPShmRingControl* m_pControl = nullptr;
+        uint8_t* m_pData = nullptr;
+        size_t m_nMask = 0;
+        int m_nWakeFd = -1;
+        uint64_t m_nHead = 0;   // producer: head including staged bytes
+        uint64_t m_nTail = 0;   // consumer: tail including bytes read but not consumed
+    };
+
+    /// \brief Shared memory segment of one connection: a ring per direction in a memfd, and four eventfds
+    /// to wake a sleeping consumer or producer. The server creates it after validation and passes the
+    /// descriptors to the client over the Unix domain socket, which then only watches for the peer closing.
+    class TCPShmChannel {
+    public:
+        using Descriptor = boost::asio::posix::stream_descriptor;
+
+        TCPShmChannel(const TCPShmChannel&) = delete;
+
+        ~TCPShmChannel() {
+            Close();
+            ReleaseMemFd();
+            ::close(m_ringTx.WakeFd());
+            ::close(m_ringRx.WakeFd());
+            munmap(m_pSegment, m_nSegmentSize);
+        }
+
+        /// \brief Create the segment of a connection, server side.
+        /// \param executor executor of the connection, eventfd waits complete on it
+        /// \param nRingBytes bytes of each ring, rounded up to a power of two
+        /// \return the channel, null if the kernel refused a resource
+        static std::unique_ptr<TCPShmChannel> Create(const Descriptor::executor_type& executor, size_t nRingBytes) {
+            size_t nSize = 4096;
+            while (nSize < nRingBytes) nSize <<= 1;
+            std::array<int, FD_COUNT> arrFds{memfd_create("tcpconn-shm", MFD_CLOEXEC)};
+            for (int i = 1; i < FD_COUNT; i++) arrFds[i] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (arrFds[0] >= 0 && ftruncate(arrFds[0], off_t(SegmentSize(nSize))) != 0) {
+                ::close(arrFds[0]);
+                arrFds[0] = -1;
+            }
+            return Open(executor, arrFds, nSize, true);
+        }
+
+        /// \brief Attach to the segment sent by the server, client side, once the socket is readable.
+        /// \param executor executor of the connection, eventfd waits complete on it
+        /// \param nSocket connected Unix domain socket
+        /// \param ec `would_block` if nothing arrived yet, another error if the peer sent no valid segment
+        static std::unique_ptr<TCPShmChannel> ReceiveFrom(const Descriptor::executor_type& executor, int nSocket,
+                                                          std::error_code& ec) {
+            Header header{};
+            iovec iov{&header, sizeof(Header)};
+            alignas(cmsghdr) char arrControl[CMSG_SPACE(sizeof(int) * FD_COUNT)]{};
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = arrControl;
+            msg.msg_controllen = sizeof(arrControl);
+            ssize_t nRead = recvmsg(nSocket, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+            if (nRead < 0) {
+                ec = std::error_code(errno, std::system_category());
+                return nullptr;
+            }
+            std::array<int, FD_COUNT> arrFds{-1, -1, -1, -1, -1};
+            cmsghdr* pCmsg = CMSG_FIRSTHDR(&msg);
+            if (pCmsg && pCmsg->cmsg_level == SOL_SOCKET && pCmsg->cmsg_type == SCM_RIGHTS &&
+                pCmsg->cmsg_len == CMSG_LEN(sizeof(int) * FD_COUNT))
+                std::memcpy(arrFds.data(), CMSG_DATA(pCmsg), sizeof(int) * FD_COUNT);
+            if (nRead != ssize_t(sizeof(Header)) || header.magic != SEGMENT_MAGIC || (msg.msg_flags & MSG_CTRUNC))
+                header.ring_size = 0;
+            auto pChannel = Open(executor, arrFds, header.ring_size, false);
+            if (!pChannel) ec = std::make_error_code(std::errc::protocol_error);
+            return pChannel;
+        }
+
+        /// \brief Pass the segment to the client, server side.
+        /// \param nSocket connected Unix domain socket
+        /// \return false if the descriptors could not be sent
+        bool SendTo(int nSocket) const {
+            Header header{SEGMENT_MAGIC, m_nRingSize};
+            iovec iov{&header, sizeof(Header)};
+            alignas(cmsghdr) char arrControl[CMSG_SPACE(sizeof(int) * FD_COUNT)]{};
+            msghdr msg{};
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = arrControl;
+            msg.msg_controllen = sizeof(arrControl);
+            cmsghdr* pCmsg = CMSG_FIRSTHDR(&msg);
+            pCmsg->cmsg_level = SOL_SOCKET;
+            pCmsg->cmsg_type = SCM_RIGHTS;
+            pCmsg->cmsg_len = CMSG_LEN(sizeof(int) * FD_COUNT);
+            std::memcpy(CMSG_DATA(pCmsg), m_arrFds.data(), sizeof(int) * FD_COUNT);
+            return sendmsg(nSocket, &msg, MSG_NOSIGNAL) == ssize_t(sizeof(Header));
+        }
+
+        /// \brief Close the memfd once it was passed to the client, the mapping keeps the memory alive.
+        void ReleaseMemFd() {
+            if (m_arrFds[0] >= 0) ::close(std::exchange(m_arrFds[0], -1));
+        }
+
+        /// \brief Ring this side writes to.
+        TCPShmRing& Tx() { return m_ringTx; }
+        /// \brief Ring this side reads from.
+        TCPShmRing& Rx() { return m_ringRx; }
+        /// \brief Signalled when the peer published data into `Rx()`.
+        Descriptor& DataEvent() { return m_descData; }
+        /// \brief Signalled when the peer consumed data from `Tx()`.
+        Descriptor& SpaceEvent() { return m_descSpace; }
+
+        [[nodiscard]] bool IsOpen() const { return m_descData.is_open(); }
+
+        /// \brief Stop waiting on the eventfds, pending waits complete with `operation_aborted`.
+        /// The mapping stays valid until the channel is destroyed.
+        void Close() {
+            boost::system::error_code ec;
+            m_descData.close(ec);
+            m_descSpace.close(ec);
+        }
+
+    private:
+        static constexpr uint64_t SEGMENT_MAGIC = 0x4B554C53484D3031;  // "KULSHM01"
+        static constexpr int FD_COUNT = 5;  // memfd, then the data and space eventfds of ring 0 and ring 1
+
+        struct Header {
+            uint64_t magic;
+            uint64_t ring_size;
+        };
+
+        // [control 0][ring 0: server to client][control 1][ring 1: client to server]
+        static size_t RingOffset(size_t nRingSize, int nRing) {
+            return size_t(nRing) * (sizeof(TCPShmRingControl) + nRingSize);
+        }
+        static size_t SegmentSize(size_t nRingSize) { return RingOffset(nRingSize, 2); }
+
+        explicit TCPShmChannel(const Descriptor::executor_type& executor)
+                : m_descData(executor), m_descSpace(executor) {}
+
+        // Takes over the descriptors, all are closed on failure
+        static std::unique_ptr<TCPShmChannel> Open(const Descriptor::executor_type& executor,
+                                                   const std::array<int, FD_COUNT>& arrFds, size_t nRingSize, bool bServer) {
+            bool bValid = nRingSize >= 4096 && (nRingSize & (nRingSize - 1)) == 0;
+            for (int nFd : arrFds) bValid = bValid && nFd >= 0;
+            void* pSegment = MAP_FAILED;
+            if (bValid) pSegment = mmap(nullptr, SegmentSize(nRingSize), PROT_READ | PROT_WRITE, MAP_SHARED, arrFds[0], 0);
+            if (pSegment == MAP_FAILED) {
+                ERROR_MSG("Cannot map shared memory segment: {}", bValid ? std::strerror(errno) : "invalid descriptors");
+                for (int nFd : arrFds) if (nFd >= 0) ::close(nFd);
+                return nullptr;
+            }
+            std::unique_ptr<TCPShmChannel> pChannel(new TCPShmChannel(executor));
+            pChannel->m_pSegment = pSegment;
+            pChannel->m_nSegmentSize = SegmentSize(nRingSize);
+            pChannel->m_nRingSize = nRingSize;
+            pChannel->m_arrFds = arrFds;
+
+            // The server writes ring 0 and reads ring 1, the client the other way round.
+            // Each side wakes the peer through the data eventfd of its Tx() and the space eventfd of its Rx().
+            int nTx = bServer ? 0 : 1, nRx = 1 - nTx;
+            auto* pBase = static_cast<uint8_t*>(pSegment);
+            auto MakeRing = [&](int nRing, int nWakeFd) {
+                uint8_t* pRing = pBase + RingOffset(nRingSize, nRing);
+                return TCPShmRing(reinterpret_cast<TCPShmRingControl*>(pRing), pRing + sizeof(TCPShmRingControl),
+                                  nRingSize, nWakeFd);
+            };
+            pChannel->m_ringTx = MakeRing(nTx, arrFds[1 + 2 * nTx]);
+            pChannel->m_ringRx = MakeRing(nRx, arrFds[2 + 2 * nRx]);
+            pChannel->m_descData.assign(arrFds[1 + 2 * nRx]);
+            pChannel->m_descSpace.assign(arrFds[2 + 2 * nTx]);
+            // The mapping outlives the memfd, only the server keeps it to pass it on
+            if (!bServer) pChannel->ReleaseMemFd();
+            return pChannel;
+        }
+
+        void* m_pSegment = nullptr;
+        size_t m_nSegmentSize = 0;
+        size_t m_nRingSize = 0;
+        std::array<int, FD_COUNT> m_arrFds{};
+        TCPShmRing m_ringTx;
+        TCPShmRing m_ringRx;
+        Descriptor m_descData;      // owns the eventfd of Rx() data
+        Descriptor m_descSpace;     // owns the eventfd of Tx() space
+    };
+
+#else
+
+    class TCPShmRing {};
+    class TCPShmChannel {};
+
+#endif
+
+} // TCPConn
+
+#endif //TCPCONN_TCPSHAREDMEMORY_H
@@ -0,0 +1,74 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPSOCKETOPTIONS_H
+#define TCPCONN_TCPSOCKETOPTIONS_H
+
+#include <optional>
+
+namespace TCPConn {
+
+    /// \brief Socket options applied to every connection on accept and connect.
+    /// Unset options keep the system default; options the platform lacks are skipped.
+    /// Read back from a connection, every option holds the effective value reported by the kernel.
+    struct TCPSocketOptions {
+
+        /// \brief Disable Nagle's algorithm, so small frames are sent without waiting for outstanding ACKs.
+        std::optional<bool> no_delay;
+
+        /// \brief Kernel send buffer in bytes (`SO_SNDBUF`), capped by `net.core.wmem_max`.
+        /// Linux reports back twice the value it kept, for its bookkeeping overhead.
+        std::optional<int> send_buffer_bytes;
+
+        /// \brief Kernel receive buffer in bytes (`SO_RCVBUF`), capped by `net.core.rmem_max` and doubled like the send buffer.
+        /// Also set on the listening socket, so accepted connections announce a matching window scale.
+        std::optional<int> receive_buffer_bytes;
+
+        /// \brief Acknowledge received data at once instead of delaying the ACK (`TCP_QUICKACK`, Linux only).
+        /// The kernel drops back to delayed ACKs on its own, so this is re-armed before every read.
+        std::optional<bool> quick_ack;
+
+        /// \brief Microseconds a blocking receive busy polls the device queue (`SO_BUSY_POLL`, Linux only).
+        /// Values above the `net.core.busy_read` limit may require `CAP_NET_ADMIN`.
+        std::optional<int> busy_poll_us;
+
+        /// \brief Probe idle connections to detect dead peers (`SO_KEEPALIVE`).
+        std::optional<bool> keep_alive;
+
+        /// \brief Idle seconds before the first keepalive probe (`TCP_KEEPIDLE`, `TCP_KEEPALIVE` on macOS).
+        std::optional<int> keep_alive_idle_s;
+
+        /// \brief Seconds between keepalive probes (`TCP_KEEPINTVL`).
+        std::optional<int> keep_alive_interval_s;
+
+        /// \brief Unanswered probes before the connection is dropped (`TCP_KEEPCNT`).
+        std::optional<int> keep_alive_count;
+
+        /// \brief Small control frames and request/response traffic: no Nagle, immediate ACKs, short busy poll.
+        static TCPSocketOptions LowLatency() {
+            TCPSocketOptions options;
+            options.no_delay = true;
+            options.quick_ack = true;
+            options.busy_poll_us = 50;
+            options.keep_alive = true;
+            options.keep_alive_idle_s = 10;
+            options.keep_alive_interval_s = 2;
+            options.keep_alive_count = 3;
+            return options;
+        }
+
+        /// \brief Large transfers: Nagle coalescing kept on and 4 MB kernel buffers to keep the pipe full.
+        static TCPSocketOptions BulkThroughput() {
+            TCPSocketOptions options;
+            options.no_delay = false;
+            options.send_buffer_bytes = 4 << 20;
+            options.receive_buffer_bytes = 4 << 20;
+            options.keep_alive = true;
+            return options;
+        }
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPSOCKETOPTIONS_H
@@ -0,0 +1,152 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPSOCKETTUNING_H
+#define TCPCONN_TCPSOCKETTUNING_H
+
+#include "TCPSocketOptions.h"
+#include "LogMacros.h"
+#include "TCPTransport.h"
+#include <boost/asio.hpp>
+
+namespace TCPConn {
+
+    /// \brief Integer socket option at an arbitrary level, for options Asio has no type of its own for.
+    template <int nLevel, int nName>
+    class TCPIntOption {
+    public:
+        TCPIntOption() = default;
+        explicit TCPIntOption(int nValue) : m_nValue(nValue) {}
+
+        [[nodiscard]] int value() const { return m_nValue; }
+
+        template <typename Protocol> int level(const Protocol&) const { return nLevel; }
+        template <typename Protocol> int name(const Protocol&) const { return nName; }
+        template <typename Protocol> int* data(const Protocol&) { return &m_nValue; }
+        template <typename Protocol> const int* data(const Protocol&) const { return &m_nValue; }
+        template <typename Protocol> size_t size(const Protocol&) const { return sizeof(m_nValue); }
+        template <typename Protocol> void resize(const Protocol&, size_t) {}
+
+    private:
+        int m_nValue = 0;
+    };
+
+    namespace detail {
+
+#if defined __linux__
+        using QuickAckOption = TCPIntOption<IPPROTO_TCP, TCP_QUICKACK>;
+        using BusyPollOption = TCPIntOption<SOL_SOCKET, SO_BUSY_POLL>;
+#endif
+#if defined __linux__ || defined _WIN32
+        using KeepIdleOption = TCPIntOption<IPPROTO_TCP, TCP_KEEPIDLE>;
+#elif defined __APPLE__
+        using KeepIdleOption = TCPIntOption<IPPROTO_TCP, TCP_KEEPALIVE>;
+#endif
+#if defined TCP_KEEPINTVL && defined TCP_KEEPCNT
+        using KeepIntervalOption = TCPIntOption<IPPROTO_TCP, TCP_KEEPINTVL>;
+        using KeepCountOption = TCPIntOption<IPPROTO_TCP, TCP_KEEPCNT>;
+#endif
+
+        template <typename Socket, typename Option>
+        void SetOption(Socket& socket, const Option& option, const char* szName) {
+            boost::system::error_code ec;
+            socket.set_option(option, ec);
+            if (ec) ERROR_MSG("Cannot set socket option {}: {}", szName, ec.message());
+        }
+
+        template <typename Socket, typename Option, typename Value>
+        void GetOption(const Socket& socket, std::optional<Value>& value) {
+            Option option;
+            boost::system::error_code ec;
+            socket.get_option(option, ec);
+            if (!ec) value = Value(option.value());
+        }
+
+    } // detail
+
+    /// \brief Whether a socket runs over TCP rather than a Unix domain socket.
+    template <typename Socket>
+    bool IsTcpSocket(const Socket& socket) {
+        boost::system::error_code ec;
+        auto endpoint = socket.local_endpoint(ec);
+        return !ec && (endpoint.data()->sa_family == AF_INET || endpoint.data()->sa_family == AF_INET6);
+    }
+
+    /// \brief Apply the options set in `options` to a connected socket.
+    /// Unix domain sockets only take the socket level options, TCP level ones are skipped.
+    template <typename Socket>
+    void ApplySocketOptions(Socket& socket, const TCPSocketOptions& options) {
+        using namespace boost::asio;
+        if (options.send_buffer_bytes)
+            detail::SetOption(socket, socket_base::send_buffer_size(*options.send_buffer_bytes), "SO_SNDBUF");
+        if (options.receive_buffer_bytes)
+            detail::SetOption(socket, socket_base::receive_buffer_size(*options.receive_buffer_bytes), "SO_RCVBUF");
+#if defined __linux__
+        if (options.busy_poll_us) detail::SetOption(socket, detail::BusyPollOption(*options.busy_poll_us), "SO_BUSY_POLL");
+#endif
+        if (!IsTcpSocket(socket)) return;
+        if (options.no_delay) detail::SetOption(socket, ip::tcp::no_delay(*options.no_delay), "TCP_NODELAY");
+        if (options.keep_alive) detail::SetOption(socket, socket_base::keep_alive(*options.keep_alive), "SO_KEEPALIVE");
+#if defined __linux__
+        if (options.quick_ack) detail::SetOption(socket, detail::QuickAckOption(*options.quick_ack), "TCP_QUICKACK");
+#endif
+#if defined __linux__ || defined _WIN32 || defined __APPLE__
+        if (options.keep_alive_idle_s)
+            detail::SetOption(socket, detail::KeepIdleOption(*options.keep_alive_idle_s), "TCP_KEEPIDLE");
+#endif
+#if defined TCP_KEEPINTVL && defined TCP_KEEPCNT
+        if (options.keep_alive_interval_s)
+            detail::SetOption(socket, detail::KeepIntervalOption(*options.keep_alive_interval_s), "TCP_KEEPINTVL");
+        if (options.keep_alive_count)
+            detail::SetOption(socket, detail::KeepCountOption(*options.keep_alive_count), "TCP_KEEPCNT");
+#endif
+    }
+
+    /// \brief Apply the options inherited by accepted sockets to a listening socket, before it accepts.
+    template <typename Acceptor>
+    void ApplyListenOptions(Acceptor& acceptor, const TCPSocketOptions& options) {
+        if (options.receive_buffer_bytes)
+            detail::SetOption(acceptor, boost::asio::socket_base::receive_buffer_size(*options.receive_buffer_bytes),
+                              "SO_RCVBUF");
+    }
+
+    /// \brief Re-enter quick ACK mode, which the kernel leaves on its own after a while.
+    template <typename Socket>
+    void RearmQuickAck(Socket& socket) {
+#if defined __linux__
+        boost::system::error_code ec;
+        socket.set_option(detail::QuickAckOption(1), ec);
+#endif
+    }
+
+    /// \brief Read back the effective options of a socket, options the platform lacks stay unset.
+    template <typename Socket>
+    TCPSocketOptions ReadSocketOptions(const Socket& socket) {
+        using namespace boost::asio;
+        TCPSocketOptions options;
+        if (!socket.is_open()) return options;
+        detail::GetOption<Socket, socket_base::send_buffer_size>(socket, options.send_buffer_bytes);
+        detail::GetOption<Socket, socket_base::receive_buffer_size>(socket, options.receive_buffer_bytes);
+#if defined __linux__
+        detail::GetOption<Socket, detail::BusyPollOption>(socket, options.busy_poll_us);
+#endif
+        if (!IsTcpSocket(socket)) return options;
+        detail::GetOption<Socket, ip::tcp::no_delay>(socket, options.no_delay);
+        detail::GetOption<Socket, socket_base::keep_alive>(socket, options.keep_alive);
+#if defined __linux__
+        detail::GetOption<Socket, detail::QuickAckOption>(socket, options.quick_ack);
+#endif
+#if defined __linux__ || defined _WIN32 || defined __APPLE__
+        detail::GetOption<Socket, detail::KeepIdleOption>(socket, options.keep_alive_idle_s);
+#endif
+#if defined TCP_KEEPINTVL && defined TCP_KEEPCNT
+        detail::GetOption<Socket, detail::KeepIntervalOption>(socket, options.keep_alive_interval_s);
+        detail::GetOption<Socket, detail::KeepCountOption>(socket, options.keep_alive_count);
+#endif
+        return options;
+    }
+
+} // TCPConn
+
+#endif //TCPCONN_TCPSOCKETTUNING_H
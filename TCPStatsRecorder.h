@@ -0,0 +1,160 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPSTATSRECORDER_H
+#define TCPCONN_TCPSTATSRECORDER_H
+
+#include "TCPConnStats.h"
+#include <atomic>
+#include <bit>
+#include <chrono>
+
+namespace TCPConn {
+
+#ifdef TCPCONN_NO_STATS
+    inline constexpr bool TCPCONN_STATS_ENABLED = false;
+#else
+    inline constexpr bool TCPCONN_STATS_ENABLED = true;
+#endif
+
+    /// \brief Counter with a single writer at a time, e.g. the strand of a connection.
+    /// Updates are a relaxed load and store rather than a locked read-modify-write,
+    /// readers on other threads see a recent value.
+    class TCPStatCounter {
+    public:
+        void Add(uint64_t n) {
+            if constexpr (TCPCONN_STATS_ENABLED)
+                m_nValue.store(m_nValue.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        void Set(uint64_t n) {
+            if constexpr (TCPCONN_STATS_ENABLED) m_nValue.store(n, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] uint64_t Get() const { return m_nValue.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> m_nValue{0};
+    };
+
+    /// \brief Single writer recorder behind `TCPLatencyHistogram`.
+    class TCPLatencyRecorder {
+    public:
+        void Record(uint64_t nNanoseconds) {
+            if constexpr (TCPCONN_STATS_ENABLED) {
+                size_t nBucket = std::min<size_t>(std::bit_width(nNanoseconds), TCPLatencyHistogram::NUM_BUCKETS - 1);
+                m_buckets[nBucket].Add(1);
+                m_nCount.Add(1);
+                m_nSum.Add(nNanoseconds);
+                if (nNanoseconds > m_nMax.Get()) m_nMax.Set(nNanoseconds);
+            }
+        }
+
+        [[nodiscard]] TCPLatencyHistogram Snapshot() const {
+            TCPLatencyHistogram histogram;
+            for (size_t i = 0; i < TCPLatencyHistogram::NUM_BUCKETS; i++) histogram.buckets[i] = m_buckets[i].Get();
+            histogram.count = m_nCount.Get();
+            histogram.sum_ns = m_nSum.Get();
+            histogram.max_ns = m_nMax.Get();
+            return histogram;
+        }
+
+    private:
+        std::array<TCPStatCounter, TCPLatencyHistogram::NUM_BUCKETS> m_buckets;
+        TCPStatCounter m_nCount;
+        TCPStatCounter m_nSum;
+        TCPStatCounter m_nMax;
+    };
+
+    /// \brief Metrics of one connection, written by one thread at a time: the io handlers of that connection,
+    /// or shared memory senders holding the connection's ring lock.
+    class TCPConnStatsRecorder {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /// \brief Current time, or a constant when stats are compiled out so no clock is read.
+        static Clock::time_point Now() {
+            if constexpr (TCPCONN_STATS_ENABLED) return Clock::now();
+            else return {};
+        }
+
+        static uint64_t Since(Clock::time_point tStart) {
+            if constexpr (TCPCONN_STATS_ENABLED)
+                return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - tStart).count());
+            else return 0;
+        }
+
+        void HandshakeStarted() { m_tHandshakeStart = Now(); }
+        void HandshakeDone() { m_nHandshake.Set(Since(m_tHandshakeStart)); }
+
+        void Received(size_t nBytes) {
+            m_nMessagesIn.Add(1);
+            m_nBytesIn.Add(nBytes);
+        }
+
+        void Written(size_t nMessages, size_t nBytes, Clock::time_point tStart) {
+            m_nMessagesOut.Add(nMessages);
+            m_nBytesOut.Add(nBytes);
+            m_writeLatency.Record(Since(tStart));
+        }
+
+        void OutgoingDepth(size_t nDepth) { m_nOutgoingDepth.Set(nDepth); }
+
+        void Compressed(size_t nBefore, size_t nAfter) {
+            m_nCompressedBodies.Add(1);
+            m_nCompressedBefore.Add(nBefore);
+            m_nCompressedAfter.Add(nAfter);
+        }
+
+        [[nodiscard]] TCPConnStats Snapshot() const {
+            TCPConnStats stats;
+            stats.bytes_in = m_nBytesIn.Get();
+            stats.bytes_out = m_nBytesOut.Get();
+            stats.messages_in = m_nMessagesIn.Get();
+            stats.messages_out = m_nMessagesOut.Get();
+            stats.outgoing_queue_depth = m_nOutgoingDepth.Get();
+            stats.handshake_ns = m_nHandshake.Get();
+            stats.write_latency = m_writeLatency.Snapshot();
+            stats.compressed_bodies = m_nCompressedBodies.Get();
+            stats.compressed_bytes_before = m_nCompressedBefore.Get();
+            stats.compressed_bytes_after = m_nCompressedAfter.Get();
+            return stats;
+        }
+
+    private:
+        TCPStatCounter m_nBytesIn;
+        TCPStatCounter m_nBytesOut;
+        TCPStatCounter m_nMessagesIn;
+        TCPStatCounter m_nMessagesOut;
+        TCPStatCounter m_nOutgoingDepth;
+        TCPStatCounter m_nHandshake;
+        TCPStatCounter m_nCompressedBodies;
+        TCPStatCounter m_nCompressedBefore;
+        TCPStatCounter m_nCompressedAfter;
+        TCPLatencyRecorder m_writeLatency;
+        Clock::time_point m_tHandshakeStart{};
+    };
+
+    /// \brief Fold the snapshot of one connection into the totals of a server.
+    inline void AccumulateStats(TCPServerStats& server, const TCPConnStats& conn) {
+        server.bytes_in += conn.bytes_in;
+        server.bytes_out += conn.bytes_out;
+        server.messages_in += conn.messages_in;
+        server.messages_out += conn.messages_out;
+        server.messages_dropped += conn.messages_dropped;
+        server.compressed_bytes_before += conn.compressed_bytes_before;
+        server.compressed_bytes_after += conn.compressed_bytes_after;
+        server.write_latency += conn.write_latency;
+        if (conn.handshake_ns > 0) {
+            auto& handshake = server.handshake_latency;
+            handshake.buckets[std::min<size_t>(std::bit_width(conn.handshake_ns), TCPLatencyHistogram::NUM_BUCKETS - 1)]++;
+            handshake.count++;
+            handshake.sum_ns += conn.handshake_ns;
+            handshake.max_ns = std::max(handshake.max_ns, conn.handshake_ns);
+        }
+    }
+
+} // TCPConn
+
+#endif //TCPCONN_TCPSTATSRECORDER_H
@@ -0,0 +1,203 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPTASK_H
+#define TCPCONN_TCPTASK_H
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace TCPConn {
+
+    /// \brief Result slot shared by an asynchronous operation and the coroutine awaiting it.
+    /// Whichever side arrives second proceeds: the completing io thread resumes a suspended coroutine
+    /// in place, or a coroutine awaiting a finished operation does not suspend at all.
+    template <typename R>
+    class TCPAsyncState {
+    public:
+        using Value = std::conditional_t<std::is_void_v<R>, std::monostate, R>;
+
+        /// \brief Complete the operation, must be called at most once together with `Fail`.
+        void Complete(Value value = {}) {
+            m_value.emplace(std::move(value));
+            Finish();
+        }
+
+        /// \brief Complete the operation with an error, rethrown as `std::system_error` in the awaiting coroutine.
+        void Fail(std::error_code ec) {
+            m_ec = ec;
+            Finish();
+        }
+
+        [[nodiscard]] bool Ready() const { return m_bArrived.load(std::memory_order_acquire); }
+
+        /// \return false if the operation completed meanwhile and the coroutine must not suspend
+        bool Suspend(std::coroutine_handle<> handle) {
+            m_handle = handle;
+            return !m_bArrived.exchange(true, std::memory_order_acq_rel);
+        }
+
+        R Take() {
+            if (m_ec) throw std::system_error(m_ec);
+            if constexpr (!std::is_void_v<R>) return std::move(*m_value);
+        }
+
+    private:
+        void Finish() {
+            if (m_bArrived.exchange(true, std::memory_order_acq_rel)) m_handle.resume();
+        }
+
+        std::optional<Value> m_value;
+        std::error_code m_ec;
+        std::coroutine_handle<> m_handle;
+        std::atomic<bool> m_bArrived{false};
+    };
+
+    /// \brief Awaitable result of an asynchronous operation of the library.
+    /// The awaiting coroutine is resumed on the io thread completing the operation, without any hop
+    /// to another thread; keep blocking work off it. Errors are thrown as `std::system_error`.
+    template <typename R>
+    class TCPAsync {
+    public:
+        explicit TCPAsync(std::shared_ptr<TCPAsyncState<R>> pState) : m_pState(std::move(pState)) {}
+
+        bool await_ready() const { return m_pState->Ready(); }
+        bool await_suspend(std::coroutine_handle<> handle) { return m_pState->Suspend(handle); }
+        R await_resume() { return m_pState->Take(); }
+
+    private:
+        std::shared_ptr<TCPAsyncState<R>> m_pState;
+    };
+
+    template <typename R>
+    class TCPTask;
+
+    namespace detail {
+
+        template <typename R>
+        struct TCPTaskPromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+            bool bDetached = false;
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+
+                template <typename P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+                    auto& promise = handle.promise();
+                    if (promise.bDetached) {
+                        // Like a thread, a detached task must not end with an exception
+                        if (promise.exception) std::terminate();
+                        handle.destroy();
+                        return std::noop_coroutine();
+                    }
+                    return promise.continuation ? promise.continuation : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            FinalAwaiter final_suspend() noexcept { return {}; }
+            void unhandled_exception() { exception = std::current_exception(); }
+        };
+
+        template <typename R>
+        struct TCPTaskPromise : TCPTaskPromiseBase<R> {
+            std::optional<R> value;
+
+            TCPTask<R> get_return_object();
+            void return_value(R v) { value.emplace(std::move(v)); }
+            R Take() {
+                if (this->exception) std::rethrow_exception(this->exception);
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct TCPTaskPromise<void> : TCPTaskPromiseBase<void> {
+            TCPTask<void> get_return_object();
+            void return_void() {}
+            void Take() {
+                if (exception) std::rethrow_exception(exception);
+            }
+        };
+
+    } // detail
+
+    /// \brief Coroutine type for writing connection logic with `co_await`.
+    /// A task is lazy: it starts when awaited by another task, or when detached.
+    template <typename R = void>
+    class TCPTask {
+    public:
+        using promise_type = detail::TCPTaskPromise<R>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        explicit TCPTask(Handle handle) : m_handle(handle) {}
+        TCPTask(TCPTask&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+        TCPTask(const TCPTask&) = delete;
+        TCPTask& operator = (TCPTask&& other) noexcept {
+            if (this != &other) {
+                if (m_handle) m_handle.destroy();
+                m_handle = std::exchange(other.m_handle, {});
+            }
+            return *this;
+        }
+
+        ~TCPTask() {
+            if (m_handle) m_handle.destroy();
+        }
+
+        /// \brief Start the task on the current thread and let it free itself once finished.
+        /// An exception escaping a detached task terminates the program.
+        void Detach() && {
+            auto handle = std::exchange(m_handle, {});
+            handle.promise().bDetached = true;
+            handle.resume();
+        }
+
+        auto operator co_await() && {
+            struct Awaiter {
+                Handle handle;
+
+                bool await_ready() noexcept { return false; }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+                    handle.promise().continuation = continuation;
+                    return handle;
+                }
+
+                R await_resume() { return handle.promise().Take(); }
+            };
+            return Awaiter{m_handle};
+        }
+
+    private:
+        Handle m_handle;
+    };
+
+    namespace detail {
+
+        template <typename R>
+        TCPTask<R> TCPTaskPromise<R>::get_return_object() {
+            return TCPTask<R>(std::coroutine_handle<TCPTaskPromise<R>>::from_promise(*this));
+        }
+
+        inline TCPTask<void> TCPTaskPromise<void>::get_return_object() {
+            return TCPTask<void>(std::coroutine_handle<TCPTaskPromise<void>>::from_promise(*this));
+        }
+
+    } // detail
+
+} // TCPConn
+
+#endif //TCPCONN_TCPTASK_H
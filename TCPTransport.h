@@ -0,0 +1,128 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPTRANSPORT_H
+#define TCPCONN_TCPTRANSPORT_H
+
+#include <boost/asio.hpp>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace TCPConn {
+
+    // Sockets are generic stream sockets, so one connection class serves both TCP and Unix domain
+    // sockets: framing, validation and callbacks stay the same, only the address differs
+    using TCPStreamSocket = boost::asio::generic::stream_protocol::socket;
+    using TCPStreamAcceptor = boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol>;
+    using TCPStreamEndpoint = boost::asio::generic::stream_protocol::endpoint;
+
+    /// \brief Prefix of Unix domain socket addresses: `unix:/path/to.sock`, or `unix:@name` in the abstract namespace.
+    inline constexpr const char* TCPCONN_UNIX_PREFIX = "unix:";
+
+    /// \brief Prefix of shared memory addresses, `shm:` followed by a Unix domain socket path or `@name`.
+    /// Connections are set up over that socket, then frames move to shared memory rings, see `TCPShmChannel`.
+    inline constexpr const char* TCPCONN_SHM_PREFIX = "shm:";
+
+    inline bool IsUnixAddress(const std::string& address) {
+        return address.rfind(TCPCONN_UNIX_PREFIX, 0) == 0;
+    }
+
+    inline bool IsShmAddress(const std::string& address) {
+        return address.rfind(TCPCONN_SHM_PREFIX, 0) == 0;
+    }
+
+    inline bool IsUnixEndpoint(const TCPStreamEndpoint& endpoint) {
+        return endpoint.data()->sa_family == AF_UNIX;
+    }
+
+    /// \brief Endpoint of a `unix:` or `shm:` address, throws `std::invalid_argument` if it is malformed or unsupported.
+    inline TCPStreamEndpoint MakeUnixEndpoint(const std::string& address) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        std::string path = address.substr(address.find(':') + 1);
+        if (path.empty()) throw std::invalid_argument("Empty Unix domain socket path: " + address);
+        // Linux abstract namespace, the leading NUL keeps it off the file system
+        if (path[0] == '@') path[0] = '\0';
+        return boost::asio::local::stream_protocol::endpoint(path);
+#else
+        throw std::invalid_argument("Unix domain sockets are not supported on this platform: " + address);
+#endif
+    }
+
+    /// \brief Endpoints to try in order when connecting, a `unix:` or `shm:` host or the resolved TCP addresses.
+    /// \param host `unix:` or `shm:` address, or host name or IP address
+    /// \param port TCP port, ignored for `unix:` and `shm:` addresses
+    inline std::vector<TCPStreamEndpoint> ResolveEndpoints(boost::asio::io_context& context, const std::string& host,
+                                                           uint16_t port) {
+        if (IsUnixAddress(host) || IsShmAddress(host)) return {MakeUnixEndpoint(host)};
+        boost::asio::ip::tcp::resolver resolver(context);
+        std::vector<TCPStreamEndpoint> vecEndpoints;
+        for (auto& entry : resolver.resolve(host, std::to_string(port)))
+            vecEndpoints.emplace_back(entry.endpoint());
+        return vecEndpoints;
+    }
+
+    /// \brief Endpoint to listen on, a `unix:` or `shm:` address, `host:port`, or `:port` or `port` on all IPv4 interfaces.
+    inline TCPStreamEndpoint MakeListenEndpoint(const std::string& address) {
+        using namespace boost::asio;
+        if (IsUnixAddress(address) || IsShmAddress(address)) return MakeUnixEndpoint(address);
+        size_t nColon = address.rfind(':');
+        if (nColon == std::string::npos)
+            return ip::tcp::endpoint(ip::tcp::v4(), uint16_t(std::stoul(address)));
+        std::string host = address.substr(0, nColon);
+        auto nPort = uint16_t(std::stoul(address.substr(nColon + 1)));
+        if (host.empty()) return ip::tcp::endpoint(ip::tcp::v4(), nPort);
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+        return ip::tcp::endpoint(ip::make_address(host), nPort);
+    }
+
+    /// \brief Path of a Unix domain socket endpoint on the file system, empty for abstract and TCP endpoints.
+    inline std::string UnixSocketPath(const TCPStreamEndpoint& endpoint) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        if (!IsUnixEndpoint(endpoint)) return {};
+        boost::asio::local::stream_protocol::endpoint local;
+        std::memcpy(local.data(), endpoint.data(), endpoint.size());
+        local.resize(endpoint.size());
+        std::string path = local.path();
+        if (path.empty() || path[0] == '\0') return {};
+        return path;
+#else
+        return {};
+#endif
+    }
+
+    /// \brief Readable form of an endpoint, an IP address or the `unix:` address.
+    inline std::string EndpointToString(const TCPStreamEndpoint& endpoint) {
+        using namespace boost::asio;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        if (IsUnixEndpoint(endpoint)) {
+            local::stream_protocol::endpoint local;
+            std::memcpy(local.data(), endpoint.data(), endpoint.size());
+            local.resize(endpoint.size());
+            std::string path = local.path();
+            // Accepted client sockets are unnamed
+            if (path.empty()) return "unix:";
+            if (path[0] == '\0') path[0] = '@';
+            return TCPCONN_UNIX_PREFIX + path;
+        }
+#endif
+        ip::tcp::endpoint tcp;
+        if (endpoint.size() > tcp.capacity()) return {};
+        std::memcpy(tcp.data(), endpoint.data(), endpoint.size());
+        tcp.resize(endpoint.size());
+        return tcp.address().to_string();
+    }
+
+    /// \brief Remove the socket file of a Unix domain socket endpoint, before binding over a stale one or after closing.
+    inline void RemoveUnixSocketFile(const TCPStreamEndpoint& endpoint) {
+        std::string path = UnixSocketPath(endpoint);
+        std::error_code ec;
+        if (!path.empty() && std::filesystem::is_socket(path, ec)) std::filesystem::remove(path, ec);
+    }
+
+} // TCPConn
+
+#endif //TCPCONN_TCPTRANSPORT_H
@@ -0,0 +1,203 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+
+#ifndef TCPCONN_TCPTYPEDDISPATCH_H
+#define TCPCONN_TCPTYPEDDISPATCH_H
+
+#include "TCPServer.h"
+#include "TCPClient.h"
+#include "TCPMsgView.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+namespace TCPConn {
+
+    /// \brief Binds a message type, e.g. a `MsgTypes` enumerator, to the payload its body carries.
+    /// A standard-layout payload must fill the body exactly and is handed over decoded;
+    /// with `void` the handler reads the body itself through a `TCPMsgView`.
+    template <auto eType, typename TPayload = void>
+    struct MessageDef {
+        using Enum = decltype(eType);
+        using Payload = TPayload;
+        static constexpr Enum type = eType;
+
+        static_assert(std::is_enum<Enum>::value, "Message types are enumerators, e.g. of MsgTypes.");
+        static_assert(std::is_void<TPayload>::value ||
+                      (std::is_standard_layout<TPayload>::value && std::is_trivially_copyable<TPayload>::value),
+                      "Payload layout is not standard. Use void and decode the body with TCPMsgView.");
+    };
+
+    /// \brief Build a message of a defined type.
+    /// \param payload payload copied into the body
+    template <typename Def>
+    TCPMsg MakeTypedMessage(const typename Def::Payload& payload) {
+        TCPMsg msg;
+        msg.header.type = uint32_t(Def::type);
+        msg << payload;
+        return msg;
+    }
+
+    namespace detail {
+
+        template <typename TPayload>
+        struct TypedArgOf { using type = const TPayload&; };
+
+        template <>
+        struct TypedArgOf<void> { using type = TCPMsgView; };
+
+        template <typename Def>
+        using TypedArg = typename TypedArgOf<typename Def::Payload>::type;
+
+        /// \brief Decode the body of a message for `Def` and pass it on.
+        /// \return false if the body size does not match the payload
+        template <typename Def, typename F>
+        bool DecodeTyped(TCPMsg& msg, F&& fn) {
+            using Payload = typename Def::Payload;
+            if constexpr (std::is_void<Payload>::value) {
+                fn(TCPMsgView(msg));
+            } else {
+                if (msg.body.size() != sizeof(Payload)) return false;
+                // In place when aligned, as heap allocated bodies are; a copy otherwise
+                if (reinterpret_cast<uintptr_t>(msg.body.data()) % alignof(Payload) == 0) {
+                    fn(*std::launder(reinterpret_cast<const Payload*>(msg.body.data())));
+                } else {
+                    Payload payload;
+                    std::memcpy(&payload, msg.body.data(), sizeof(Payload));
+                    fn(payload);
+                }
+            }
+            return true;
+        }
+
+        /// \brief Jump table from message type to the member decoding it, built at compile time.
+        template <typename TOwner, typename TEntry, typename... Defs>
+        struct TypedTable {
+            static constexpr size_t SIZE = std::max({size_t(Defs::type)...}) + 1;
+            static_assert(SIZE <= 4096, "Message types are table indices, keep them small and dense.");
+
+            static constexpr bool Unique() {
+                std::array<size_t, sizeof...(Defs)> types{size_t(Defs::type)...};
+                for (size_t i = 0; i < types.size(); i++)
+                    for (size_t j = i + 1; j < types.size(); j++)
+                        if (types[i] == types[j]) return false;
+                return true;
+            }
+            static_assert(Unique(), "Each message type may be defined only once.");
+
+            static constexpr std::array<TEntry, SIZE> Make() {
+                std::array<TEntry, SIZE> table{};
+                ((table[size_t(Defs::type)] = &TOwner::template Dispatch<Defs>), ...);
+                return table;
+            }
+
+            static constexpr std::array<TEntry, SIZE> entries = Make();
+        };
+
+    } // detail
+
+    /// \brief Handler of one message type on a `TypedServer`.
+    template <typename Def>
+    class TypedServerHandler {
+    public:
+        virtual ~TypedServerHandler() = default;
+
+        /// \brief On a message of this type, must be overridden.
+        /// \param client socket pointer to the client that sent the message
+        /// \param def tag selecting the message type
+        /// \param payload decoded payload, valid until the handler returns
+        virtual void OnTypedMessage(std::shared_ptr<ITCPConn<TCPMsg>> client, Def def, detail::TypedArg<Def> payload) = 0;
+    };
+
+    /// \brief Server dispatching `TCPMsg` by type to one handler per `MessageDef`.
+    /// A missing `OnTypedMessage` override leaves the derived server abstract, so it does not compile.
+    template <typename TEnum, typename... Defs>
+    class TypedServer : public ITCPServer<TCPMsg>, public TypedServerHandler<Defs>... {
+    public:
+        static_assert((std::is_same<typename Defs::Enum, TEnum>::value && ...), "Message types must be of TEnum.");
+
+        using ITCPServer<TCPMsg>::ITCPServer;
+
+        /// \brief On a message whose type has no `MessageDef`, does nothing by default.
+        /// \param client socket pointer to the client that sent the message
+        /// \param msg received message
+        virtual void OnUnknownMessage(std::shared_ptr<ITCPConn<TCPMsg>> client, TCPMsg& msg) {}
+
+        /// \brief On a message whose body does not match the size of its payload, does nothing by default.
+        /// \param client socket pointer to the client that sent the message
+        /// \param msg received message
+        virtual void OnMalformedMessage(std::shared_ptr<ITCPConn<TCPMsg>> client, TCPMsg& msg) {}
+
+        void OnMessage(std::shared_ptr<ITCPConn<TCPMsg>> client, TCPMsg& msg) final {
+            const auto& entries = Table::entries;
+            if (msg.header.type < entries.size() && entries[msg.header.type])
+                (this->*entries[msg.header.type])(client, msg);
+            else
+                OnUnknownMessage(std::move(client), msg);
+        }
+
+        template <typename Def>
+        void Dispatch(std::shared_ptr<ITCPConn<TCPMsg>>& client, TCPMsg& msg) {
+            bool bDecoded = detail::DecodeTyped<Def>(msg, [&](detail::TypedArg<Def> payload) {
+                static_cast<TypedServerHandler<Def>&>(*this).OnTypedMessage(client, Def{}, payload);
+            });
+            if (!bDecoded) OnMalformedMessage(client, msg);
+        }
+
+    private:
+        using Entry = void (TypedServer::*)(std::shared_ptr<ITCPConn<TCPMsg>>&, TCPMsg&);
+        using Table = detail::TypedTable<TypedServer, Entry, Defs...>;
+    };
+
+    /// \brief Handler of one message type on a `TypedClient`.
+    template <typename Def>
+    class TypedClientHandler {
+    public:
+        virtual ~TypedClientHandler() = default;
+
+        /// \brief On a message of this type, must be overridden.
+        /// \param def tag selecting the message type
+        /// \param payload decoded payload, valid until the handler returns
+        virtual void OnTypedMessage(Def def, detail::TypedArg<Def> payload) = 0;
+    };
+
+    /// \brief Client dispatching `TCPMsg` by type to one handler per `MessageDef`, see `TypedServer`.
+    template <typename TEnum, typename... Defs>
+    class TypedClient : public ITCPClient<TCPMsg>, public TypedClientHandler<Defs>... {
+    public:
+        static_assert((std::is_same<typename Defs::Enum, TEnum>::value && ...), "Message types must be of TEnum.");
+
+        using ITCPClient<TCPMsg>::ITCPClient;
+
+        /// \brief On a message whose type has no `MessageDef`, does nothing by default.
+        virtual void OnUnknownMessage(TCPMsg& msg) {}
+
+        /// \brief On a message whose body does not match the size of its payload, does nothing by default.
+        virtual void OnMalformedMessage(TCPMsg& msg) {}
+
+        void OnMessage(TCPMsg& msg) final {
+            const auto& entries = Table::entries;
+            if (msg.header.type < entries.size() && entries[msg.header.type])
+                (this->*entries[msg.header.type])(msg);
+            else
+                OnUnknownMessage(msg);
+        }
+
+        template <typename Def>
+        void Dispatch(TCPMsg& msg) {
+            bool bDecoded = detail::DecodeTyped<Def>(msg, [&](detail::TypedArg<Def> payload) {
+                static_cast<TypedClientHandler<Def>&>(*this).OnTypedMessage(Def{}, payload);
+            });
+            if (!bDecoded) OnMalformedMessage(msg);
+        }
+
+    private:
+        using Entry = void (TypedClient::*)(TCPMsg&);
+        using Table = detail::TypedTable<TypedClient, Entry, Defs...>;
+    };
+
+} // TCPConn
+
+#endif //TCPCONN_TCPTYPEDDISPATCH_H
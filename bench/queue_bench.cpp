@@ -0,0 +1,77 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+// Micro benchmark of the incoming message queue modes: N producer threads push
+// `TCPMsgOwned<TCPMsg>` items while one consumer drains them the way `Update()` does.
+// Prints one JSON object per run.
+//
+
+#include "TCPMsg.h"
+#include "TCPMsgQueue.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace TCPConn;
+
+namespace {
+
+    const char* ModeName(EQueueMode mode) {
+        switch (mode) {
+            case EQueueMode::locked: return "locked";
+            case EQueueMode::spsc: return "spsc";
+            case EQueueMode::mpsc: return "mpsc";
+        }
+        return "unknown";
+    }
+
+    void RunCase(EQueueMode mode, int nProducers, size_t nMessages) {
+        TCPMsgQueue<TCPMsgOwned<TCPMsg>> queue(mode, 4096);
+        size_t nPerProducer = nMessages / nProducers;
+        size_t nTotal = nPerProducer * nProducers;
+
+        auto tStart = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (int p = 0; p < nProducers; p++) {
+            producers.emplace_back([&queue, nPerProducer, p]() {
+                TCPMsgOwned<TCPMsg> item;
+                item.msg.header.type = uint32_t(p);
+                for (size_t i = 0; i < nPerProducer; i++) {
+                    item.msg.header.size = uint32_t(i);
+                    queue.push_back(item);
+                }
+            });
+        }
+
+        size_t nReceived = 0, nWaits = 0;
+        TCPMsgOwned<TCPMsg> item;
+        while (nReceived < nTotal) {
+            queue.wait();
+            nWaits++;
+            while (queue.try_pop_front(item)) nReceived++;
+        }
+        auto tEnd = std::chrono::steady_clock::now();
+        for (auto& t : producers) t.join();
+
+        double dSeconds = std::chrono::duration<double>(tEnd - tStart).count();
+        std::printf("{\"bench\":\"queue\",\"mode\":\"%s\",\"producers\":%d,\"messages\":%zu,"
+                    "\"seconds\":%.6f,\"msgs_per_sec\":%.0f,\"consumer_wakeups\":%zu}\n",
+                    ModeName(mode), nProducers, nTotal, dSeconds, double(nTotal) / dSeconds, nWaits);
+    }
+
+}
+
+int main(int argc, char** argv) {
+    size_t nMessages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    RunCase(EQueueMode::locked, 1, nMessages);
+    RunCase(EQueueMode::spsc, 1, nMessages);
+    RunCase(EQueueMode::mpsc, 1, nMessages);
+    for (int nProducers : {2, 4}) {
+        RunCase(EQueueMode::locked, nProducers, nMessages);
+        RunCase(EQueueMode::mpsc, nProducers, nMessages);
+    }
+    return 0;
+}
@@ -0,0 +1,464 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+// Loopback benchmark of the full stack: an `ITCPServer` echoes or broadcasts what `ITCPClient`s
+// (`TCPMsg`) or `ITCPRawMsgSender`s (`TCPRawMsg`, 8 byte header with the payload length at offset 4)
+// send over 127.0.0.1. Every message carries its send time, so each delivery yields one latency
+// sample: the round trip for unicast, publisher to subscriber through the server for broadcast.
+// The process CPU time per delivery is reported too; its system share follows the syscall cost of
+// the I/O engine, so compare an epoll and an io_uring build at high client counts.
+// Prints one JSON object per case, run with --help for the options.
+//
+
+#include "TCPServer.h"
+#include "TCPClient.h"
+#include "TCPRawMsgSender.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#if defined __APPLE__ || defined __linux__
+#include <sys/resource.h>
+#endif
+
+using namespace TCPConn;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t STAMP_SIZE = sizeof(int64_t);
+    constexpr size_t RAW_HEADER_SIZE = 8;
+    constexpr size_t RAW_LENGTH_OFFSET = 4;
+
+    enum class EMode { unicast, broadcast };
+
+    struct Options {
+        std::vector<size_t> sizes{16, 256, 4096, 64 * 1024, 1 << 20, 16 << 20};
+        std::vector<size_t> clients{1, 10, 100, 1000};
+        std::vector<std::string> kinds{"msg", "raw"};
+        std::vector<std::string> modes{"unicast", "broadcast"};
+        std::vector<std::string> profiles{"default"};
+        std::vector<std::string> transports{"tcp"};
+        size_t window = 8;                          // messages in flight per sender
+        size_t case_bytes = size_t(128) << 20;      // delivered bytes targeted per case
+        size_t max_messages = 200000;               // delivered messages cap per case
+        size_t max_inflight_bytes = size_t(1) << 30;
+        size_t io_threads = 1;
+        EReadMode read_mode = EReadMode::exact;
+        EQueueMode queue_mode = EQueueMode::locked;
+        uint16_t port = 9300;
+        double timeout = 60;
+        std::string out = "-";
+    };
+
+    struct Result {
+        const char* status = "ok";
+        size_t window = 0;
+        size_t deliveries = 0;
+        size_t bytes = 0;
+        double seconds = 0;
+        int64_t user_ns = 0;                        // process CPU time while the case ran
+        int64_t sys_ns = 0;                         // kernel share, dominated by socket syscalls
+        std::vector<int64_t> latencies;
+    };
+
+    int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    /// \brief User and system CPU time consumed by the process so far, both ends of every connection included.
+    std::pair<int64_t, int64_t> CpuTime() {
+#if defined __APPLE__ || defined __linux__
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        auto Ns = [](const timeval& tv) { return int64_t(tv.tv_sec) * 1000000000 + int64_t(tv.tv_usec) * 1000; };
+        return {Ns(usage.ru_utime), Ns(usage.ru_stime)};
+#else
+        return {0, 0};
+#endif
+    }
+
+    /* ----- Peers ----- */
+
+    template <typename TMsg>
+    class BenchServer : public ITCPServer<TMsg> {
+    public:
+        BenchServer(const std::string& address, const TCPConnConfig& config, EMode mode)
+            : ITCPServer<TMsg>(address, config), m_eMode(mode) {}
+
+        void OnClientConnected(std::shared_ptr<ITCPConn<TMsg>> client) override { m_nClients++; }
+
+        void OnMessage(std::shared_ptr<ITCPConn<TMsg>> client, TMsg& msg) override {
+            if (m_eMode == EMode::unicast) this->MessageClient(client, std::move(msg));
+            else this->MessageAllClients(msg);
+        }
+
+        std::atomic<size_t> m_nClients{0};
+
+    private:
+        EMode m_eMode;
+    };
+
+    template <typename TMsg>
+    using BenchClientBase = std::conditional_t<std::is_same<TMsg, TCPMsg>::value, ITCPClient<TCPMsg>, ITCPRawMsgSender>;
+
+    template <typename TMsg>
+    class BenchClient : public BenchClientBase<TMsg> {
+    public:
+        explicit BenchClient(const TCPConnConfig& config) requires std::is_same<TMsg, TCPMsg>::value
+            : BenchClientBase<TMsg>(config) {}
+
+        explicit BenchClient(const TCPConnConfig& config) requires std::is_same<TMsg, TCPRawMsg>::value
+            : BenchClientBase<TMsg>(RAW_HEADER_SIZE, RAW_LENGTH_OFFSET, 4, false, false, config) {}
+
+        /// \brief Arm the client for a case.
+        /// \param tmpl message sent, its send time is stamped into every copy
+        /// \param nToSend messages this client sends, 0 for a pure receiver
+        /// \param nWindow messages kept in flight
+        /// \param nExpected messages this client receives before it is done
+        void Prepare(const TMsg* tmpl, size_t nToSend, size_t nWindow, size_t nExpected) {
+            m_pTemplate = tmpl;
+            m_nToSend = nToSend;
+            m_nWindow = nWindow;
+            m_nExpected = nExpected;
+            m_nSent = 0;
+            m_nReceived = 0;
+            m_tDone = 0;
+            m_vecLatencies.clear();
+            m_vecLatencies.reserve(nExpected);
+        }
+
+        void Kick() {
+            for (size_t i = 0; i < m_nWindow && m_nSent < m_nToSend; i++) SendNext();
+        }
+
+        /// \brief Drain the incoming queue without blocking.
+        void Poll() {
+            if constexpr (std::is_same<TMsg, TCPMsg>::value) this->Update(false);
+            else this->Update(size_t(-1), false);
+        }
+
+        void OnConnected() override { m_bConnected = true; }
+
+        void OnMessage(TMsg& msg) override {
+            int64_t nNow = Now();
+            int64_t nStamp;
+            std::memcpy(&nStamp, msg.body.data() + StampOffset(), STAMP_SIZE);
+            m_vecLatencies.push_back(nNow - nStamp);
+            if (m_nSent < m_nToSend) SendNext();
+            if (++m_nReceived == m_nExpected) m_tDone = nNow;
+        }
+
+        static constexpr size_t StampOffset() {
+            return std::is_same<TMsg, TCPMsg>::value ? 0 : RAW_HEADER_SIZE;
+        }
+
+        std::atomic<bool> m_bConnected{false};
+        std::atomic<size_t> m_nReceived{0};
+        std::atomic<int64_t> m_tDone{0};
+        std::vector<int64_t> m_vecLatencies;
+
+    private:
+        void SendNext() {
+            TMsg msg(*m_pTemplate);
+            int64_t nStamp = Now();
+            std::memcpy(msg.body.data() + StampOffset(), &nStamp, STAMP_SIZE);
+            this->Send(std::move(msg));
+            m_nSent++;
+        }
+
+        const TMsg* m_pTemplate = nullptr;
+        size_t m_nToSend = 0;
+        size_t m_nWindow = 1;
+        size_t m_nExpected = 0;
+        size_t m_nSent = 0;
+    };
+
+    /// \brief Message of the given wire size, header included.
+    template <typename TMsg>
+    TMsg MakeMessage(size_t nSize) {
+        TMsg msg;
+        if constexpr (std::is_same<TMsg, TCPMsg>::value) {
+            msg.header.type = 1;
+            msg.body.resize(nSize - sizeof(TCPMsgHeader));
+            msg.header.size = uint32_t(msg.full_size());
+        } else {
+            msg.body.resize(nSize);
+            auto nLength = uint32_t(nSize - RAW_HEADER_SIZE);
+            std::memcpy(msg.body.data() + RAW_LENGTH_OFFSET, &nLength, sizeof(nLength));
+        }
+        return msg;
+    }
+
+    /* ----- Cases ----- */
+
+    TCPSocketOptions ProfileOptions(const std::string& profile) {
+        if (profile == "low_latency") return TCPSocketOptions::LowLatency();
+        if (profile == "bulk_throughput") return TCPSocketOptions::BulkThroughput();
+        return {};
+    }
+
+    template <typename TMsg>
+    Result RunCase(const Options& opt, const std::string& transport, const std::string& profile, EMode mode,
+                   size_t nSize, size_t nClients) {
+        Result result;
+        // Every sender keeps a window in flight, each message is buffered once per receiving client
+        if (nSize * nClients > opt.max_inflight_bytes) {
+            result.status = "skipped";
+            return result;
+        }
+        result.window = std::clamp<size_t>(opt.max_inflight_bytes / (nSize * nClients), 1, opt.window);
+
+        TCPConnConfig config;
+        config.io_threads = opt.io_threads;
+        config.read_mode = opt.read_mode;
+        config.incoming_queue_mode = opt.queue_mode;
+        config.socket_options = ProfileOptions(profile);
+        TCPConnConfig clientConfig = config;
+        if (clientConfig.incoming_queue_mode == EQueueMode::mpsc) clientConfig.incoming_queue_mode = EQueueMode::spsc;
+
+        // Unix domain sockets and shared memory share the framing, only the address differs
+        std::string strLocal = transport + ":/tmp/tcpconn_bench_" + std::to_string(opt.port) + ".sock";
+        bool bLocal = transport == "unix" || transport == "shm";
+        BenchServer<TMsg> server(bLocal ? strLocal : ":" + std::to_string(opt.port), config, mode);
+        if (!server.Start()) {
+            result.status = "server_failed";
+            return result;
+        }
+        std::atomic<bool> bStopServer{false};
+        std::thread thrServer([&]() { while (!bStopServer) server.Update(true); });
+
+        std::vector<std::unique_ptr<BenchClient<TMsg>>> vecClients;
+        bool bConnected = true;
+        for (size_t i = 0; i < nClients && bConnected; i++) {
+            vecClients.push_back(std::make_unique<BenchClient<TMsg>>(clientConfig));
+            bConnected = vecClients.back()->Connect(bLocal ? strLocal : "127.0.0.1", opt.port);
+        }
+        auto tDeadline = Clock::now() + std::chrono::duration<double>(opt.timeout);
+        auto AllConnected = [&]() {
+            if (server.m_nClients < nClients) return false;
+            return std::all_of(vecClients.begin(), vecClients.end(), [](auto& c) { return c->m_bConnected.load(); });
+        };
+        while (bConnected && !AllConnected()) {
+            if (Clock::now() > tDeadline) bConnected = false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        if (bConnected) {
+            size_t nTarget = std::clamp<size_t>(opt.case_bytes / nSize, 1, opt.max_messages);
+            size_t nPerClient = std::max<size_t>(1, nTarget / nClients);
+            TMsg tmpl = MakeMessage<TMsg>(nSize);
+            for (size_t i = 0; i < nClients; i++) {
+                if (mode == EMode::unicast) vecClients[i]->Prepare(&tmpl, nPerClient, result.window, nPerClient);
+                else vecClients[i]->Prepare(&tmpl, i == 0 ? nPerClient : 0, result.window, nPerClient);
+            }
+
+            // Clients are drained by a few polling threads instead of one thread each
+            size_t nDrivers = std::min<size_t>(nClients, std::max(1u, std::thread::hardware_concurrency() / 2));
+            std::atomic<bool> bStopDrivers{false};
+            std::vector<std::thread> vecDrivers;
+            for (size_t d = 0; d < nDrivers; d++) {
+                vecDrivers.emplace_back([&, d]() {
+                    while (!bStopDrivers) {
+                        for (size_t i = d; i < nClients; i += nDrivers) vecClients[i]->Poll();
+                        std::this_thread::yield();
+                    }
+                });
+            }
+
+            int64_t tStart = Now();
+            auto [nUserStart, nSysStart] = CpuTime();
+            for (auto& client : vecClients) client->Kick();
+            auto AllDone = [&]() {
+                return std::all_of(vecClients.begin(), vecClients.end(), [](auto& c) { return c->m_tDone != 0; });
+            };
+            while (!AllDone() && Clock::now() < tDeadline)
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            bool bDone = AllDone();
+            auto [nUserEnd, nSysEnd] = CpuTime();
+            result.user_ns = nUserEnd - nUserStart;
+            result.sys_ns = nSysEnd - nSysStart;
+            bStopDrivers = true;
+            for (auto& thr : vecDrivers) thr.join();
+
+            int64_t tEnd = tStart;
+            for (auto& client : vecClients) {
+                tEnd = std::max<int64_t>(tEnd, client->m_tDone);
+                result.deliveries += client->m_nReceived;
+                result.latencies.insert(result.latencies.end(),
+                                        client->m_vecLatencies.begin(), client->m_vecLatencies.end());
+            }
+            if (!bDone) {
+                result.status = "timeout";
+                tEnd = Now();
+            }
+            result.bytes = result.deliveries * nSize;
+            result.seconds = double(tEnd - tStart) / 1e9;
+        } else {
+            result.status = "connect_failed";
+        }
+
+        vecClients.clear();
+        bStopServer = true;
+        server.Stop();
+        thrServer.join();
+        return result;
+    }
+
+    int64_t Percentile(std::vector<int64_t>& vec, double dRank) {
+        if (vec.empty()) return 0;
+        auto nIndex = std::min(vec.size() - 1, size_t(dRank * double(vec.size())));
+        std::nth_element(vec.begin(), vec.begin() + long(nIndex), vec.end());
+        return vec[nIndex];
+    }
+
+    void Report(FILE* out, const char* kind, const std::string& transport, const std::string& profile, const char* mode, size_t nSize, size_t nClients,
+                const Options& opt, Result& result) {
+        double dSeconds = result.seconds > 0 ? result.seconds : 1;
+        int64_t nP50 = Percentile(result.latencies, 0.50);
+        int64_t nP99 = Percentile(result.latencies, 0.99);
+        int64_t nP999 = Percentile(result.latencies, 0.999);
+        int64_t nMax = result.latencies.empty() ? 0 : *std::max_element(result.latencies.begin(), result.latencies.end());
+        double dDeliveries = result.deliveries > 0 ? double(result.deliveries) : 1;
+        std::fprintf(out, "{\"bench\":\"tcpconn\",\"engine\":\"%s\",\"kind\":\"%s\",\"transport\":\"%s\",\"profile\":\"%s\",\"mode\":\"%s\",\"size\":%zu,\"clients\":%zu,"
+                          "\"window\":%zu,\"io_threads\":%zu,\"status\":\"%s\",\"messages\":%zu,\"seconds\":%.6f,"
+                          "\"msgs_per_sec\":%.0f,\"mb_per_sec\":%.2f,"
+                          "\"cpu_ns_per_msg\":{\"user\":%.0f,\"sys\":%.0f},"
+                          "\"rtt_ns\":{\"p50\":%lld,\"p99\":%lld,\"p999\":%lld,\"max\":%lld}}\n",
+                     GetIoEngine(), kind, transport.c_str(), profile.c_str(), mode, nSize, nClients, result.window, opt.io_threads, result.status, result.deliveries,
+                     result.seconds, double(result.deliveries) / dSeconds, double(result.bytes) / dSeconds / 1e6,
+                     double(result.user_ns) / dDeliveries, double(result.sys_ns) / dDeliveries,
+                     (long long) nP50, (long long) nP99, (long long) nP999, (long long) nMax);
+        std::fflush(out);
+    }
+
+    /* ----- Command line ----- */
+
+    template <typename T>
+    std::vector<T> SplitList(const std::string& str) {
+        std::vector<T> vec;
+        size_t nBegin = 0;
+        while (nBegin <= str.size()) {
+            size_t nEnd = str.find(',', nBegin);
+            if (nEnd == std::string::npos) nEnd = str.size();
+            std::string item = str.substr(nBegin, nEnd - nBegin);
+            if (!item.empty()) {
+                if constexpr (std::is_same<T, std::string>::value) vec.push_back(item);
+                else vec.push_back(T(std::strtoull(item.c_str(), nullptr, 10)));
+            }
+            nBegin = nEnd + 1;
+        }
+        return vec;
+    }
+
+    void PrintUsage() {
+        std::printf(
+            "Usage: tcpconn_bench [options]\n"
+            "  --sizes LIST         message sizes in bytes, header included (default 16,256,4096,65536,1048576,16777216)\n"
+            "  --clients LIST       client counts (default 1,10,100,1000)\n"
+            "  --kinds LIST         msg (ITCPClient) and/or raw (ITCPRawMsgSender) (default msg,raw)\n"
+            "  --modes LIST         unicast (echo) and/or broadcast (client 0 publishes to all) (default both)\n"
+            "  --profiles LIST      socket options: default, low_latency and/or bulk_throughput (default default)\n"
+            "  --transports LIST    tcp (loopback), unix (Unix domain socket) and/or shm (shared memory) (default tcp)\n"
+            "  --window N           messages in flight per sender (default 8)\n"
+            "  --case-bytes N       delivered bytes targeted per case (default 134217728)\n"
+            "  --max-messages N     delivered messages cap per case (default 200000)\n"
+            "  --max-inflight N     skip cases buffering more than N bytes at once (default 1073741824)\n"
+            "  --io-threads N       server io threads (default 1)\n"
+            "  --read-mode M        exact or buffered (default exact)\n"
+            "  --queue M            locked or mpsc incoming queue, clients use spsc for mpsc (default locked)\n"
+            "  --port N             loopback port (default 9300)\n"
+            "  --timeout S          seconds before a case is reported as timeout (default 60)\n"
+            "  --out FILE           write the JSON lines to FILE instead of stdout, which also carries the library log\n");
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& opt) {
+        for (int i = 1; i < argc; i++) {
+            std::string key = argv[i];
+            if (key == "--help" || key == "-h") return false;
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for %s\n", key.c_str());
+                return false;
+            }
+            std::string value = argv[++i];
+            if (key == "--sizes") opt.sizes = SplitList<size_t>(value);
+            else if (key == "--clients") opt.clients = SplitList<size_t>(value);
+            else if (key == "--kinds") opt.kinds = SplitList<std::string>(value);
+            else if (key == "--modes") opt.modes = SplitList<std::string>(value);
+            else if (key == "--profiles") opt.profiles = SplitList<std::string>(value);
+            else if (key == "--transports") opt.transports = SplitList<std::string>(value);
+            else if (key == "--window") opt.window = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+            else if (key == "--case-bytes") opt.case_bytes = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "--max-messages") opt.max_messages = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+            else if (key == "--max-inflight") opt.max_inflight_bytes = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "--io-threads") opt.io_threads = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "--read-mode") opt.read_mode = value == "buffered" ? EReadMode::buffered : EReadMode::exact;
+            else if (key == "--queue") opt.queue_mode = value == "mpsc" ? EQueueMode::mpsc : EQueueMode::locked;
+            else if (key == "--port") opt.port = uint16_t(std::strtoul(value.c_str(), nullptr, 10));
+            else if (key == "--timeout") opt.timeout = std::strtod(value.c_str(), nullptr);
+            else if (key == "--out") opt.out = value;
+            else {
+                std::fprintf(stderr, "Unknown option %s\n", key.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief Both ends of every connection live in this process, 1000 clients need 2000+ descriptors.
+    void RaiseDescriptorLimit() {
+#if defined __APPLE__ || defined __linux__
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+#endif
+    }
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseOptions(argc, argv, opt)) {
+        PrintUsage();
+        return 1;
+    }
+    RaiseDescriptorLimit();
+
+    FILE* out = stdout;
+    if (opt.out != "-" && !(out = std::fopen(opt.out.c_str(), "w"))) {
+        std::fprintf(stderr, "Cannot open %s\n", opt.out.c_str());
+        return 1;
+    }
+
+    for (auto& transport : opt.transports) {
+        for (auto& profile : opt.profiles) {
+            for (auto& kind : opt.kinds) {
+                for (auto& modeName : opt.modes) {
+                    EMode mode = modeName == "broadcast" ? EMode::broadcast : EMode::unicast;
+                    for (size_t nClients : opt.clients) {
+                        for (size_t nSize : opt.sizes) {
+                            nSize = std::max(nSize, RAW_HEADER_SIZE + STAMP_SIZE);
+                            Result result = kind == "raw"
+                                    ? RunCase<TCPRawMsg>(opt, transport, profile, mode, nSize, nClients)
+                                    : RunCase<TCPMsg>(opt, transport, profile, mode, nSize, nClients);
+                            Report(out, kind == "raw" ? "raw" : "msg", transport, profile,
+                                   mode == EMode::broadcast ? "broadcast" : "unicast", nSize, nClients, opt, result);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (out != stdout) std::fclose(out);
+    return 0;
+}
@@ -28,6 +28,10 @@ class PyTCPClient(tcp.TCPClientMsg):
       - send_msg(msg), send_text(text, type), send_bytes(b, type)
       - wait_for_message(timeout, predicate)
       - pump_until(timeout, predicate, wait=False)
+
+    `msg.body` is a writable memoryview of the message body, without copying it;
+    `numpy.frombuffer(msg, dtype)` reads it in place as an array. As with a bytearray,
+    assigning `msg.body` or calling `msg.from_bytes()` raises BufferError while such views are alive.
     """
 
     def __init__(self):
@@ -93,10 +97,11 @@ class PyTCPClient(tcp.TCPClientMsg):
         b = text.encode(encoding)
         return self.send_bytes(b, type)
 
-    def send_bytes(self, b: bytes, type: int = 1) -> tcp.TCPMsg:
+    def send_bytes(self, b, type: int = 1) -> tcp.TCPMsg:
+        """Send any bytes-like object (bytes, bytearray, memoryview, numpy array), copied once into the body."""
         m = tcp.TCPMsg()
         m.header.type = type
-        m.body = list(b)
+        m.from_bytes(b)
         self.send_msg(m)
         return m
 
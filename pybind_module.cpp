@@ -5,10 +5,61 @@
 
 #include "TCPClient.h"
 #include "TCPMsg.h"
+#include "TCPLog.h"
+#include <unordered_map>
 
 namespace py = pybind11;
 using namespace TCPConn;
 
+// Views exported per body, touched with the GIL held. Like a bytearray, a body with live views
+// cannot be assigned, so no view ever points into a freed buffer.
+static std::unordered_map<const std::vector<uint8_t>*, Py_ssize_t> g_mapBodyExports;
+
+// Body exported through the buffer protocol, so memoryview, bytes() and numpy use it in place
+template <typename TMsg>
+static int GetBodyBuffer(PyObject* obj, Py_buffer* view, int flags) {
+    TMsg* pMsg;
+    try {
+        pMsg = py::cast<TMsg*>(py::handle(obj));
+    } catch (const std::exception& e) {
+        PyErr_SetString(PyExc_BufferError, e.what());
+        return -1;
+    }
+    if (PyBuffer_FillInfo(view, obj, pMsg->body.data(), Py_ssize_t(pMsg->body.size()), 0, flags) != 0) return -1;
+    view->internal = &pMsg->body;
+    g_mapBodyExports[&pMsg->body]++;
+    return 0;
+}
+
+static void ReleaseBodyBuffer(PyObject*, Py_buffer* view) {
+    auto it = g_mapBodyExports.find(static_cast<const std::vector<uint8_t>*>(view->internal));
+    if (it != g_mapBodyExports.end() && --it->second == 0) g_mapBodyExports.erase(it);
+}
+
+// Replace the buffer slots of a class declared with py::buffer_protocol(), which def_buffer cannot count releases on
+template <typename TMsg>
+static py::class_<TMsg> ExportBody(py::class_<TMsg> cls) {
+    PyBufferProcs* pProcs = reinterpret_cast<PyTypeObject*>(cls.ptr())->tp_as_buffer;
+    pProcs->bf_getbuffer = GetBodyBuffer<TMsg>;
+    pProcs->bf_releasebuffer = ReleaseBodyBuffer;
+    return cls;
+}
+
+// Copy any contiguous bytes-like object into a body with one memcpy, other sequences of ints element by element.
+// Raises BufferError while views of the body are alive.
+static void AssignBody(std::vector<uint8_t>& body, const py::object& data) {
+    if (g_mapBodyExports.count(&body)) throw py::buffer_error("Existing exports of data: object cannot be re-sized");
+    Py_buffer view;
+    if (PyObject_CheckBuffer(data.ptr()) && PyObject_GetBuffer(data.ptr(), &view, PyBUF_SIMPLE) == 0) {
+        auto* pData = static_cast<const uint8_t*>(view.buf);
+        body.assign(pData, pData + view.len);
+        PyBuffer_Release(&view);
+        return;
+    }
+    PyErr_Clear();
+    body = data.cast<std::vector<uint8_t>>();
+}
+
 // Trampoline for ITCPClient<TCPMsg>
 struct PyITCPClientTCPMsg : ITCPClient<TCPMsg> {
     using ITCPClient<TCPMsg>::ITCPClient;
@@ -20,6 +71,14 @@ struct PyITCPClientTCPMsg : ITCPClient<TCPMsg> {
         py::gil_scoped_acquire gil;
         PYBIND11_OVERRIDE(void, ITCPClient<TCPMsg>, OnDisconnected);
     }
+    void OnBackpressure() override {
+        py::gil_scoped_acquire gil;
+        PYBIND11_OVERRIDE(void, ITCPClient<TCPMsg>, OnBackpressure);
+    }
+    void OnWritable() override {
+        py::gil_scoped_acquire gil;
+        PYBIND11_OVERRIDE(void, ITCPClient<TCPMsg>, OnWritable);
+    }
     void OnMessage(TCPMsg& msg) override {
         py::gil_scoped_acquire gil;
         PYBIND11_OVERRIDE_PURE(void, ITCPClient<TCPMsg>, OnMessage, msg);
@@ -37,6 +96,14 @@ struct PyITCPClientTCPRawMsg : ITCPClient<TCPRawMsg> {
         py::gil_scoped_acquire gil;
         PYBIND11_OVERRIDE(void, ITCPClient<TCPRawMsg>, OnDisconnected);
     }
+    void OnBackpressure() override {
+        py::gil_scoped_acquire gil;
+        PYBIND11_OVERRIDE(void, ITCPClient<TCPRawMsg>, OnBackpressure);
+    }
+    void OnWritable() override {
+        py::gil_scoped_acquire gil;
+        PYBIND11_OVERRIDE(void, ITCPClient<TCPRawMsg>, OnWritable);
+    }
     void OnMessage(TCPRawMsg& msg) override {
         py::gil_scoped_acquire gil;
         PYBIND11_OVERRIDE_PURE(void, ITCPClient<TCPRawMsg>, OnMessage, msg);
@@ -46,42 +113,82 @@ struct PyITCPClientTCPRawMsg : ITCPClient<TCPRawMsg> {
 PYBIND11_MODULE(tcpconn_py, m) {
     m.doc() = "Python bindings for TCPConn TCPClient";
 
+    py::enum_<ELogLevel>(m, "LogLevel")
+        .value("debug", ELogLevel::debug)
+        .value("info", ELogLevel::info)
+        .value("error", ELogLevel::error)
+        .value("off", ELogLevel::off);
+
+    m.def("set_log_level", &SetLogLevel, py::arg("level"));
+    m.def("flush_log", &FlushLog, py::call_guard<py::gil_scoped_release>());
+    m.def("get_io_engine", &GetIoEngine);
+
     py::class_<TCPMsgHeader>(m, "TCPMsgHeader")
         .def(py::init<>())
         .def_readwrite("type", &TCPMsgHeader::type)
         .def_readwrite("size", &TCPMsgHeader::size);
 
-    py::class_<TCPMsg>(m, "TCPMsg")
+    ExportBody(py::class_<TCPMsg>(m, "TCPMsg", py::buffer_protocol()))
         .def(py::init<>())
         .def_readwrite("header", &TCPMsg::header)
-        .def_readwrite("body", &TCPMsg::body)
+        .def_property("body", [](py::object self) { return py::memoryview(self); },
+                      [](TCPMsg& self, const py::object& data) { AssignBody(self.body, data); })
         .def("formatted", &TCPMsg::formatted)
         .def("full_size", &TCPMsg::full_size)
+        .def("to_bytes", [](const TCPMsg& self) {
+            return py::bytes(reinterpret_cast<const char*>(self.body.data()), self.body.size());
+        })
+        .def("from_bytes", [](TCPMsg& self, const py::object& data) {
+            AssignBody(self.body, data);
+            self.header.size = uint32_t(self.full_size());
+        })
         .def("__repr__", [](const TCPMsg& self){ return self.formatted(); });
 
-    py::class_<TCPRawMsg>(m, "TCPRawMsg")
+    ExportBody(py::class_<TCPRawMsg>(m, "TCPRawMsg", py::buffer_protocol()))
         .def(py::init<>())
-        .def_readwrite("body", &TCPRawMsg::body)
+        .def_property("body", [](py::object self) { return py::memoryview(self); },
+                      [](TCPRawMsg& self, const py::object& data) { AssignBody(self.body, data); })
         .def("formatted", &TCPRawMsg::formatted)
         .def("full_size", &TCPRawMsg::full_size)
         .def("to_bytes", [](const TCPRawMsg& self) {
             return py::bytes(reinterpret_cast<const char*>(self.body.data()), self.body.size());
         })
-        .def("from_bytes", [](TCPRawMsg& self, py::bytes b) {
-            char* buf; py::ssize_t len;
-            PYBIND11_BYTES_AS_STRING_AND_SIZE(b.ptr(), &buf, &len);
-            self.body.assign(reinterpret_cast<uint8_t*>(buf), reinterpret_cast<uint8_t*>(buf) + len);
-        })
+        .def("from_bytes", [](TCPRawMsg& self, const py::object& data) { AssignBody(self.body, data); })
         .def("__repr__", [](const TCPRawMsg& self){ return self.formatted(); });
 
+    py::class_<TCPLatencyHistogram>(m, "TCPLatencyHistogram")
+        .def_readonly("buckets", &TCPLatencyHistogram::buckets)
+        .def_readonly("count", &TCPLatencyHistogram::count)
+        .def_readonly("sum_ns", &TCPLatencyHistogram::sum_ns)
+        .def_readonly("max_ns", &TCPLatencyHistogram::max_ns)
+        .def("mean_ns", &TCPLatencyHistogram::mean_ns)
+        .def("percentile_ns", &TCPLatencyHistogram::percentile_ns, py::arg("rank"));
+
+    py::class_<TCPConnStats>(m, "TCPConnStats")
+        .def_readonly("bytes_in", &TCPConnStats::bytes_in)
+        .def_readonly("bytes_out", &TCPConnStats::bytes_out)
+        .def_readonly("messages_in", &TCPConnStats::messages_in)
+        .def_readonly("messages_out", &TCPConnStats::messages_out)
+        .def_readonly("messages_dropped", &TCPConnStats::messages_dropped)
+        .def_readonly("outgoing_queue_depth", &TCPConnStats::outgoing_queue_depth)
+        .def_readonly("incoming_queue_depth", &TCPConnStats::incoming_queue_depth)
+        .def_readonly("handshake_ns", &TCPConnStats::handshake_ns)
+        .def_readonly("write_latency", &TCPConnStats::write_latency)
+        .def_readonly("compression_negotiated", &TCPConnStats::compression_negotiated)
+        .def_readonly("compressed_bodies", &TCPConnStats::compressed_bodies)
+        .def_readonly("compressed_bytes_before", &TCPConnStats::compressed_bytes_before)
+        .def_readonly("compressed_bytes_after", &TCPConnStats::compressed_bytes_after)
+        .def("compression_ratio", &TCPConnStats::compression_ratio);
+
     py::class_<ITCPClient<TCPMsg>, PyITCPClientTCPMsg>(m, "TCPClientMsg")
         .def(py::init<>())
         .def("connect", &ITCPClient<TCPMsg>::Connect, py::arg("host"), py::arg("port"))
         .def("disconnect", &ITCPClient<TCPMsg>::Disconnect)
         .def("is_connected", &ITCPClient<TCPMsg>::IsConnected)
-        .def("send", &ITCPClient<TCPMsg>::Send, py::arg("msg"))
+        .def("send", py::overload_cast<const TCPMsg&>(&ITCPClient<TCPMsg>::Send, py::const_), py::arg("msg"))
         .def("update", &ITCPClient<TCPMsg>::Update, py::arg("wait"), py::arg("max_messages") = static_cast<size_t>(-1), py::call_guard<py::gil_scoped_release>())
         .def("run", &ITCPClient<TCPMsg>::Run, py::call_guard<py::gil_scoped_release>())
+        .def("get_stats", &ITCPClient<TCPMsg>::GetStats)
         ;
 
     py::class_<ITCPClient<TCPRawMsg>, PyITCPClientTCPRawMsg>(m, "TCPClientRaw")
@@ -89,8 +196,9 @@ PYBIND11_MODULE(tcpconn_py, m) {
         .def("connect", &ITCPClient<TCPRawMsg>::Connect, py::arg("host"), py::arg("port"))
         .def("disconnect", &ITCPClient<TCPRawMsg>::Disconnect)
         .def("is_connected", &ITCPClient<TCPRawMsg>::IsConnected)
-        .def("send", &ITCPClient<TCPRawMsg>::Send, py::arg("msg"))
+        .def("send", py::overload_cast<const TCPRawMsg&>(&ITCPClient<TCPRawMsg>::Send, py::const_), py::arg("msg"))
         .def("update", &ITCPClient<TCPRawMsg>::Update, py::arg("wait"), py::arg("max_messages") = static_cast<size_t>(-1), py::call_guard<py::gil_scoped_release>())
         .def("run", &ITCPClient<TCPRawMsg>::Run, py::call_guard<py::gil_scoped_release>())
+        .def("get_stats", &ITCPClient<TCPRawMsg>::GetStats)
         ;
 }
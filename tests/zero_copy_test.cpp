@@ -0,0 +1,272 @@
+//
+// Created by Bohan Leng on 10/16/2026.
+//
+// Counts the copies of a `TCPMsg` body made on its way from the sending API to the socket, and from
+// the socket to `OnMessage`. A copy allocates exactly the body size, while pooled receive buffers are
+// allocated at the capacity of their size class, so every allocation of exactly the body size in
+// this process is a copy. The peers live in a forked child so their allocations are not counted.
+// Sending: this process broadcasts to the child's clients and sends to the child's server. Moved and
+// shared payloads must not be copied at all, `const T&` payloads once per call, never once per receiver.
+// Receiving: the child's clients and server send back moved and shared payloads, and no body may be
+// copied until the last of them reached `OnMessage`.
+// Exits with 0 when every count matches, Linux and macOS only.
+//
+
+#include "TCPServer.h"
+#include "TCPClient.h"
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace TCPConn;
+
+namespace {
+
+    constexpr size_t BODY_SIZE = (size_t(1) << 20) + 13;         // no other allocation of the stack has this size
+    constexpr size_t POOLED_SIZE = std::bit_ceil(BODY_SIZE);    // capacity of a pooled receive buffer
+    constexpr uint32_t READY_TYPE = 1;
+    constexpr uint32_t BODY_TYPE = 2;
+    constexpr uint16_t PARENT_PORT = 9461;
+    constexpr uint16_t CHILD_PORT = 9462;
+    constexpr size_t RECEIVERS = 4;
+    constexpr size_t BODIES_PER_RECEIVER = 4;  // sent back by each child client in the receive phase
+    constexpr size_t BODIES_TO_CLIENT = 4;     // broadcast back by the child server in the receive phase
+    constexpr auto TIMEOUT = std::chrono::seconds(20);
+
+    std::atomic<size_t> g_nBodyAllocations{0};
+    std::atomic<size_t> g_nPooledAllocations{0};
+
+    TCPMsg MakeBody() {
+        TCPMsg msg;
+        msg.header.type = BODY_TYPE;
+        msg.body.resize(BODY_SIZE, 0x5a);
+        msg.header.size = uint32_t(msg.full_size());
+        return msg;
+    }
+
+    // One byte through a pipe, the two processes step through the phases with it
+    bool Signal(int fd) {
+        char c = 1;
+        return write(fd, &c, 1) == 1;
+    }
+
+    bool Await(int fd) {
+        char c;
+        return read(fd, &c, 1) == 1;
+    }
+
+    /* ----- Child: peers ----- */
+
+    class Receiver : public ITCPClient<TCPMsg> {
+    public:
+        void OnConnected() override { m_bConnected = true; }
+        void OnMessage(TCPMsg& msg) override {
+            if (msg.header.type == BODY_TYPE && msg.body.size() == BODY_SIZE) m_nBodies++;
+        }
+
+        std::atomic<bool> m_bConnected{false};
+        std::atomic<size_t> m_nBodies{0};
+    };
+
+    class BodySink : public ITCPServer<TCPMsg> {
+    public:
+        using ITCPServer<TCPMsg>::ITCPServer;
+        void OnMessage(std::shared_ptr<ITCPConn<TCPMsg>> client, TCPMsg& msg) override {
+            if (msg.header.type == BODY_TYPE && msg.body.size() == BODY_SIZE) m_nBodies++;
+        }
+
+        std::atomic<size_t> m_nBodies{0};
+    };
+
+    /// \brief Receive 3 bodies per client (2 broadcasts, 1 direct) and 2 on the server, then send
+    /// bodies back to the parent and stay up until it got them. 0 when every step succeeded.
+    int RunChild(int fdToParent, int fdFromParent) {
+        BodySink sink(CHILD_PORT);
+        sink.Start();
+        if (!Signal(fdToParent) || !Await(fdFromParent)) return 2;
+
+        std::vector<std::unique_ptr<Receiver>> vecReceivers;
+        for (size_t i = 0; i < RECEIVERS; i++) {
+            vecReceivers.push_back(std::make_unique<Receiver>());
+            vecReceivers.back()->Connect("127.0.0.1", PARENT_PORT);
+        }
+        std::vector<bool> vecReady(RECEIVERS, false);
+        bool bDone = false;
+        auto tEnd = std::chrono::steady_clock::now() + TIMEOUT;
+        while (!bDone && std::chrono::steady_clock::now() < tEnd) {
+            bDone = sink.m_nBodies == 2;
+            for (size_t i = 0; i < RECEIVERS; i++) {
+                auto& receiver = *vecReceivers[i];
+                // Announce once validated, the parent sends nothing before every receiver is ready
+                if (!vecReady[i] && receiver.m_bConnected) {
+                    TCPMsg ready;
+                    ready.header.type = READY_TYPE;
+                    receiver.Send(std::move(ready));
+                    vecReady[i] = true;
+                }
+                receiver.Update(false);
+                bDone = bDone && receiver.m_nBodies == 3;
+            }
+            sink.Update(false);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!bDone) {
+            std::fprintf(stderr, "child: timed out, server got %zu bodies\n", sink.m_nBodies.load());
+            return 1;
+        }
+
+        // Receive phase, the parent counts from here
+        if (!Signal(fdToParent) || !Await(fdFromParent)) return 2;
+        for (auto& receiver : vecReceivers)
+            for (size_t i = 0; i < BODIES_PER_RECEIVER; i++) receiver->Send(MakeBody());
+        for (size_t i = 0; i < BODIES_TO_CLIENT; i++) sink.MessageAllClients(std::make_shared<const TCPMsg>(MakeBody()));
+        return Await(fdFromParent) ? 0 : 2;
+    }
+
+    /* ----- Parent: counted side ----- */
+
+    class Broadcaster : public ITCPServer<TCPMsg> {
+    public:
+        using ITCPServer<TCPMsg>::ITCPServer;
+        void OnMessage(std::shared_ptr<ITCPConn<TCPMsg>> client, TCPMsg& msg) override {
+            if (msg.header.type == READY_TYPE) m_vecReady.push_back(client->GetID());
+            else if (msg.header.type == BODY_TYPE && msg.body.size() == BODY_SIZE) m_nBodies++;
+        }
+
+        std::vector<uint64_t> m_vecReady;  // touched by Update() only
+        size_t m_nBodies = 0;
+    };
+
+    class Sender : public ITCPClient<TCPMsg> {
+    public:
+        void OnConnected() override { m_bConnected = true; }
+        void OnMessage(TCPMsg& msg) override {
+            if (msg.header.type == BODY_TYPE && msg.body.size() == BODY_SIZE) m_nBodies++;
+        }
+
+        std::atomic<bool> m_bConnected{false};
+        size_t m_nBodies = 0;
+    };
+
+    int g_nFailures = 0;
+
+    /// \brief Compare the body allocations since the last check with the expected count.
+    void Expect(const char* szCase, size_t nExpected) {
+        size_t nCopies = g_nBodyAllocations.exchange(0);
+        std::printf("%-44s %zu body copies, expected %zu\n", szCase, nCopies, nExpected);
+        if (nCopies != nExpected) g_nFailures++;
+    }
+
+    template <typename TPred>
+    bool WaitFor(TPred pred, const std::function<void()>& fnPoll = {}) {
+        auto tEnd = std::chrono::steady_clock::now() + TIMEOUT;
+        while (!pred()) {
+            if (std::chrono::steady_clock::now() >= tEnd) return false;
+            if (fnPoll) fnPoll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    int Fail(pid_t child, const char* szWhat) {
+        std::fprintf(stderr, "parent: %s\n", szWhat);
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+        return 1;
+    }
+
+    int RunParent(pid_t child, int fdFromChild, int fdToChild) {
+        Broadcaster server(PARENT_PORT);
+        server.Start();
+        if (!Await(fdFromChild) || !Signal(fdToChild)) return Fail(child, "child did not start");
+
+        Sender sender;
+        sender.Connect("127.0.0.1", CHILD_PORT);
+        if (!WaitFor([&] { return sender.m_bConnected.load(); }) ||
+            !WaitFor([&] { return server.m_vecReady.size() == RECEIVERS; }, [&] { server.Update(false); }))
+            return Fail(child, "peers did not connect");
+
+        // Allocations between a call and its check come from that call, on the calling thread
+        TCPMsg msg = MakeBody();
+        g_nBodyAllocations = 0;
+        server.MessageAllClients(msg);
+        Expect("ITCPServer::MessageAllClients(const T&)", 1);
+
+        msg = MakeBody();
+        g_nBodyAllocations = 0;
+        server.MessageAllClients(std::make_shared<const TCPMsg>(std::move(msg)));
+        Expect("ITCPServer::MessageAllClients(shared)", 0);
+
+        std::vector<TCPMsg> vecDirect;
+        for (size_t i = 0; i < RECEIVERS; i++) vecDirect.push_back(MakeBody());
+        g_nBodyAllocations = 0;
+        for (size_t i = 0; i < RECEIVERS; i++) server.MessageClient(server.m_vecReady[i], std::move(vecDirect[i]));
+        Expect("ITCPServer::MessageClient(id, T&&)", 0);
+
+        msg = MakeBody();
+        g_nBodyAllocations = 0;
+        sender.Send(std::move(msg));
+        Expect("ITCPClient::Send(T&&)", 0);
+
+        msg = MakeBody();
+        g_nBodyAllocations = 0;
+        sender.Send(msg);
+        Expect("ITCPClient::Send(const T&)", 1);
+
+        // Whatever the io threads allocate while writing is a copy per receiver
+        if (!Await(fdFromChild)) return Fail(child, "receivers did not get every body");
+        Expect("io threads while writing", 0);
+
+        // Receive phase: from the socket through the incoming queue to OnMessage, only pooled buffers
+        // may be allocated. Counted until the last body was handled, including its release to the pool.
+        g_nBodyAllocations = 0;
+        g_nPooledAllocations = 0;
+        if (!Signal(fdToChild)) return Fail(child, "child is gone");
+        if (!WaitFor([&] { return server.m_nBodies == RECEIVERS * BODIES_PER_RECEIVER && sender.m_nBodies == BODIES_TO_CLIENT; },
+                     [&] { server.Update(false); sender.Update(false); }))
+            return Fail(child, "bodies sent back did not arrive");
+        std::printf("%-44s %zu pooled receive buffers allocated for %zu bodies\n", "receive path",
+                    g_nPooledAllocations.load(), RECEIVERS * BODIES_PER_RECEIVER + BODIES_TO_CLIENT);
+        Expect("socket to ITCPServer/ITCPClient::OnMessage", 0);
+
+        Signal(fdToChild);
+        int nStatus = 0;
+        waitpid(child, &nStatus, 0);
+        if (!WIFEXITED(nStatus) || WEXITSTATUS(nStatus) != 0) {
+            std::fprintf(stderr, "parent: child failed\n");
+            g_nFailures++;
+        }
+        return g_nFailures == 0 ? 0 : 1;
+    }
+
+} // namespace
+
+void* operator new(size_t nBytes) {
+    if (nBytes == BODY_SIZE) g_nBodyAllocations.fetch_add(1, std::memory_order_relaxed);
+    else if (nBytes == POOLED_SIZE) g_nPooledAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(nBytes ? nBytes : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+int main() {
+    // Forked before any thread starts, the pipes step both processes through the phases
+    int fdsToParent[2], fdsToChild[2];
+    if (pipe(fdsToParent) != 0 || pipe(fdsToChild) != 0) return 2;
+    pid_t child = fork();
+    if (child < 0) return 2;
+    if (child == 0) std::_Exit(RunChild(fdsToParent[1], fdsToChild[0]));
+    return RunParent(child, fdsToParent[0], fdsToChild[1]);
+}